@@ -0,0 +1,61 @@
+/*
+ * Example on how to use the Wiegand reader library with interruptions,
+ * receiving the facility code and card number of each card instead of its raw bits.
+ */
+
+#include <Wiegand.h>
+#include <WiegandFrameQueue.h>
+
+// These are the pins connected to the Wiegand D0 and D1 signals.
+// Ensure your board supports external Interruptions on these pins
+#define PIN_D0 2
+#define PIN_D1 3
+
+// The object that handles the wiegand protocol
+Wiegand wiegand;
+
+// Up to 8 cards can wait here until the main loop handles them
+WiegandCredentialQueue<8> cards;
+
+// Initialize Wiegand reader
+void setup() {
+  Serial.begin(9600);
+
+  //Send all cards to the queue and initialize Wiegand reader
+  cards.attach(wiegand);
+  wiegand.begin(Wiegand::LENGTH_ANY, true);
+
+  //initialize pins as INPUT and attaches interruptions
+  pinMode(PIN_D0, INPUT);
+  pinMode(PIN_D1, INPUT);
+  attachInterrupt(digitalPinToInterrupt(PIN_D0), pinStateChanged, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(PIN_D1), pinStateChanged, CHANGE);
+
+  //Sends the initial pin state to the Wiegand library
+  pinStateChanged();
+}
+
+// Every few milliseconds, check for pending messages on the wiegand reader and handle queued cards.
+void loop() {
+  noInterrupts();
+  wiegand.flush();
+  interrupts();
+
+  WiegandCredential card;
+  while (cards.tryPop(card)) {
+    Serial.print(WiegandFormats::name(card.format));
+    Serial.print(" - Facility: ");
+    Serial.print(card.facility);
+    Serial.print(" / Card: ");
+    Serial.println((unsigned long)card.card);
+  }
+
+  //Sleep a little -- this doesn't have to run very often.
+  delay(100);
+}
+
+// When any of the pins have changed, update the state of the wiegand library
+void pinStateChanged() {
+  wiegand.setPin0State(digitalRead(PIN_D0));
+  wiegand.setPin1State(digitalRead(PIN_D1));
+}
@@ -0,0 +1,89 @@
+/*
+ * Example on how to use the Wiegand reader library with interruptions,
+ * decoding messages outside of the interruption handler.
+ */
+
+#include <DeferredWiegand.h>
+
+// These are the pins connected to the Wiegand D0 and D1 signals.
+// Ensure your board supports external Interruptions on these pins
+#define PIN_D0 2
+#define PIN_D1 3
+
+// The object that handles the wiegand protocol.
+// Up to 64 pin changes (31 bits) can be recorded between calls to `wiegand.process()`
+DeferredWiegand<64> wiegand;
+
+// Initialize Wiegand reader
+void setup() {
+  Serial.begin(9600);
+
+  //Install listeners and initialize Wiegand reader
+  wiegand.onReceive(receivedData, "Card readed: ");
+  wiegand.onReceiveError(receivedDataError, "Card read error: ");
+  wiegand.onStateChange(stateChanged, "State changed: ");
+  wiegand.begin(Wiegand::LENGTH_ANY, true);
+
+  //initialize pins as INPUT and attaches interruptions
+  pinMode(PIN_D0, INPUT);
+  pinMode(PIN_D1, INPUT);
+  attachInterrupt(digitalPinToInterrupt(PIN_D0), pinStateChanged, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(PIN_D1), pinStateChanged, CHANGE);
+
+  //Sends the initial pin state to the Wiegand library
+  pinStateChanged();
+}
+
+// Every few milliseconds, decode the pin changes recorded by the interruption handler.
+// Callbacks are called from here, and there is no need to disable interruptions.
+void loop() {
+  wiegand.process();
+  //Sleep a little -- Messages must not be longer than the queue in the meantime
+  delay(20);
+}
+
+// When any of the pins have changed, record it. Decoding happens later, inside `loop()`.
+// Both pins are read, but only the one that changed takes room in the queue
+void pinStateChanged() {
+  wiegand.queuePin0State(digitalRead(PIN_D0));
+  wiegand.queuePin1State(digitalRead(PIN_D1));
+}
+
+// Notifies when a reader has been connected or disconnected.
+// Instead of a message, the seconds parameter can be anything you want -- Whatever you specify on `wiegand.onStateChange()`
+void stateChanged(bool plugged, const char* message) {
+    Serial.print(message);
+    Serial.println(plugged ? "CONNECTED" : "DISCONNECTED");
+}
+
+// Notifies when a card was read.
+// Instead of a message, the seconds parameter can be anything you want -- Whatever you specify on `wiegand.onReceive()`
+void receivedData(uint8_t* data, uint8_t bits, const char* message) {
+    Serial.print(message);
+    Serial.print(bits);
+    Serial.print("bits / ");
+    //Print value in HEX
+    uint8_t bytes = (bits+7)/8;
+    for (int i=0; i<bytes; i++) {
+        Serial.print(data[i] >> 4, 16);
+        Serial.print(data[i] & 0xF, 16);
+    }
+    Serial.println();
+}
+
+// Notifies when an invalid transmission is detected
+void receivedDataError(Wiegand::DataError error, uint8_t* rawData, uint8_t rawBits, const char* message) {
+    Serial.print(message);
+    Serial.print(Wiegand::DataErrorStr(error));
+    Serial.print(" - Raw data: ");
+    Serial.print(rawBits);
+    Serial.print("bits / ");
+
+    //Print value in HEX
+    uint8_t bytes = (rawBits+7)/8;
+    for (int i=0; i<bytes; i++) {
+        Serial.print(rawData[i] >> 4, 16);
+        Serial.print(rawData[i] & 0xF, 16);
+    }
+    Serial.println();
+}
@@ -0,0 +1,78 @@
+/*
+ * Example on how to use the Wiegand reader library with interruptions,
+ * queueing received messages to be handled at leisure by the main loop.
+ */
+
+#include <Wiegand.h>
+#include <WiegandFrameQueue.h>
+
+// These are the pins connected to the Wiegand D0 and D1 signals.
+// Ensure your board supports external Interruptions on these pins
+#define PIN_D0 2
+#define PIN_D1 3
+
+// The object that handles the wiegand protocol
+Wiegand wiegand;
+
+// Up to 8 messages can wait here until the main loop handles them
+WiegandFrameQueue<8> messages;
+
+// Initialize Wiegand reader
+void setup() {
+  Serial.begin(9600);
+
+  //Send all messages to the queue and initialize Wiegand reader
+  messages.attach(wiegand);
+  wiegand.begin(Wiegand::LENGTH_ANY, true);
+
+  //initialize pins as INPUT and attaches interruptions
+  pinMode(PIN_D0, INPUT);
+  pinMode(PIN_D1, INPUT);
+  attachInterrupt(digitalPinToInterrupt(PIN_D0), pinStateChanged, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(PIN_D1), pinStateChanged, CHANGE);
+
+  //Sends the initial pin state to the Wiegand library
+  pinStateChanged();
+}
+
+// Every few milliseconds, check for pending messages on the wiegand reader and handle queued messages.
+void loop() {
+  noInterrupts();
+  wiegand.flush();
+  interrupts();
+
+  WiegandFrame message;
+  while (messages.tryPop(message)) {
+    printMessage(message);
+  }
+
+  //Sleep a little -- this doesn't have to run very often.
+  delay(100);
+}
+
+// When any of the pins have changed, update the state of the wiegand library
+void pinStateChanged() {
+  wiegand.setPin0State(digitalRead(PIN_D0));
+  wiegand.setPin1State(digitalRead(PIN_D1));
+}
+
+// Prints a message taken from the queue
+void printMessage(const WiegandFrame& message) {
+    if (message.valid) {
+      Serial.print("Card readed: ");
+    } else {
+      Serial.print("Card read error: ");
+      Serial.print(Wiegand::DataErrorStr(message.error));
+      Serial.print(" - Raw data: ");
+    }
+    Serial.print(message.bits);
+    Serial.print("bits / ");
+
+    //Print value in HEX
+    uint8_t bytes = (message.bits+7)/8;
+    for (int i=0; i<bytes; i++) {
+        Serial.print(message.data[i] >> 4, 16);
+        Serial.print(message.data[i] & 0xF, 16);
+    }
+    Serial.println();
+}
@@ -0,0 +1,115 @@
+/*
+ * Example on how to use the Wiegand reader library on a battery-powered board,
+ * sleeping between pin changes instead of polling `flush()` every few milliseconds.
+ *
+ * While a message is being received, the board sleeps in idle mode until its deadline.
+ * Once the line is quiet, it powers down, and only the next pin change wakes it up.
+ *
+ * This example uses the pin change interruption of port D of an AVR (Arduino Uno, Nano...):
+ * External interruptions (INT0 / INT1) can't wake it from power-down on a change.
+ */
+
+#include <Wiegand.h>
+#include <avr/sleep.h>
+
+// These are the pins connected to the Wiegand D0 and D1 signals: PD2 and PD3
+#define PIN_D0 2
+#define PIN_D1 3
+
+// The object that handles the wiegand protocol
+Wiegand wiegand;
+
+// Initialize Wiegand reader
+void setup() {
+  Serial.begin(9600);
+
+  //Install listeners and initialize Wiegand reader
+  wiegand.onReceive(receivedData, "Card readed: ");
+  wiegand.onReceiveError(receivedDataError, "Card read error: ");
+  wiegand.onStateChange(stateChanged, "State changed: ");
+  wiegand.begin(Wiegand::LENGTH_ANY, true);
+
+  //initialize pins as INPUT and enables their pin change interruptions
+  pinMode(PIN_D0, INPUT);
+  pinMode(PIN_D1, INPUT);
+  PCMSK2 = _BV(PCINT18) | _BV(PCINT19);
+  PCIFR = _BV(PCIF2);
+  PCICR = _BV(PCIE2);
+
+  //Sends the initial pin state to the Wiegand library
+  noInterrupts();
+  pinStateChanged();
+  interrupts();
+}
+
+// Ends messages when their deadline comes, and sleeps until then -- or until the next pin change.
+// This executes with interruptions disabled, since the Wiegand library is not thread-safe
+void loop() {
+  noInterrupts();
+  wiegand.flush();
+
+  unsigned long deadline;
+  if (wiegand.nextDeadline(deadline) || millis() - wiegand.lastEventTime() <= Wiegand::TIMEOUT) {
+    //Receiving a message, or waiting for the line to settle: millis() must keep running.
+    //Timer0 wakes up every millisecond, so this only lasts until the deadline
+    set_sleep_mode(SLEEP_MODE_IDLE);
+  } else {
+    //Nothing can happen until the next pin change.
+    //millis() stops while powered down, so this is only done once `flush()` has nothing left to do
+    Serial.flush();
+    set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+  }
+  sleep_enable();
+  //Interruptions are only enabled after the next instruction, so a pin change can't be missed before sleeping
+  interrupts();
+  sleep_cpu();
+  sleep_disable();
+}
+
+// When any of the pins have changed, update the state of the wiegand library
+void pinStateChanged() {
+  wiegand.setPin0State(digitalRead(PIN_D0));
+  wiegand.setPin1State(digitalRead(PIN_D1));
+}
+
+ISR(PCINT2_vect) {
+  pinStateChanged();
+}
+// Notifies when a reader has been connected or disconnected.
+// Instead of a message, the seconds parameter can be anything you want -- Whatever you specify on `wiegand.onStateChange()`
+void stateChanged(bool plugged, const char* message) {
+    Serial.print(message);
+    Serial.println(plugged ? "CONNECTED" : "DISCONNECTED");
+}
+
+// Notifies when a card was read.
+// Instead of a message, the seconds parameter can be anything you want -- Whatever you specify on `wiegand.onReceive()`
+void receivedData(uint8_t* data, uint8_t bits, const char* message) {
+    Serial.print(message);
+    Serial.print(bits);
+    Serial.print("bits / ");
+    //Print value in HEX
+    uint8_t bytes = (bits+7)/8;
+    for (int i=0; i<bytes; i++) {
+        Serial.print(data[i] >> 4, 16);
+        Serial.print(data[i] & 0xF, 16);
+    }
+    Serial.println();
+}
+
+// Notifies when an invalid transmission is detected
+void receivedDataError(Wiegand::DataError error, uint8_t* rawData, uint8_t rawBits, const char* message) {
+    Serial.print(message);
+    Serial.print(Wiegand::DataErrorStr(error));
+    Serial.print(" - Raw data: ");
+    Serial.print(rawBits);
+    Serial.print("bits / ");
+
+    //Print value in HEX
+    uint8_t bytes = (rawBits+7)/8;
+    for (int i=0; i<bytes; i++) {
+        Serial.print(rawData[i] >> 4, 16);
+        Serial.print(rawData[i] & 0xF, 16);
+    }
+    Serial.println();
+}
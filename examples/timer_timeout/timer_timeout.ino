@@ -0,0 +1,114 @@
+/*
+ * Example on how to use the Wiegand reader library with interruptions,
+ * ending messages from a hardware timer instead of calling `flush()` inside `loop()`.
+ *
+ * This example uses Timer1 of an AVR (Arduino Uno, Nano, Mega...), which must not be used by anything else.
+ */
+
+#include <TimedWiegand.h>
+
+// These are the pins connected to the Wiegand D0 and D1 signals.
+// Ensure your board supports external Interruptions on these pins
+#define PIN_D0 2
+#define PIN_D1 3
+
+// One-shot timer on Timer1, using the compare match A interruption.
+// With a 1024 prescaler, each tick is 64us on a 16MHz board
+class Timer1 {
+public:
+  void start(unsigned long micros) {
+    TCCR1B = 0;
+    TCNT1 = 0;
+    OCR1A = micros / 64;
+    TIFR1 = _BV(OCF1A);
+    TIMSK1 = _BV(OCIE1A);
+    TCCR1B = _BV(WGM12) | _BV(CS12) | _BV(CS10);
+  }
+
+  void stop() {
+    TCCR1B = 0;
+    TIMSK1 = 0;
+  }
+};
+
+Timer1 timer;
+
+// The object that handles the wiegand protocol, every pin change arms the timer for the end of the message
+TimedWiegand<Timer1> wiegand(timer);
+
+// Initialize Wiegand reader
+void setup() {
+  Serial.begin(9600);
+
+  TCCR1A = 0;
+
+  //Install listeners and initialize Wiegand reader
+  wiegand.onReceive(receivedData, "Card readed: ");
+  wiegand.onReceiveError(receivedDataError, "Card read error: ");
+  wiegand.onStateChange(stateChanged, "State changed: ");
+  wiegand.begin(Wiegand::LENGTH_ANY, true);
+
+  //initialize pins as INPUT and attaches interruptions
+  pinMode(PIN_D0, INPUT);
+  pinMode(PIN_D1, INPUT);
+  attachInterrupt(digitalPinToInterrupt(PIN_D0), pinStateChanged, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(PIN_D1), pinStateChanged, CHANGE);
+
+  //Sends the initial pin state to the Wiegand library
+  pinStateChanged();
+}
+
+// Nothing to do here: Messages are sent out by the timer, as soon as the reader stops sending bits
+void loop() {
+}
+
+// The message has timed out: End it. The timer is armed again if needed
+ISR(TIMER1_COMPA_vect) {
+  timer.stop();
+  wiegand.timerExpired();
+}
+
+// When any of the pins have changed, update the state of the wiegand library
+void pinStateChanged() {
+  wiegand.setPin0State(digitalRead(PIN_D0));
+  wiegand.setPin1State(digitalRead(PIN_D1));
+}
+
+// Notifies when a reader has been connected or disconnected.
+// Instead of a message, the seconds parameter can be anything you want -- Whatever you specify on `wiegand.onStateChange()`
+void stateChanged(bool plugged, const char* message) {
+    Serial.print(message);
+    Serial.println(plugged ? "CONNECTED" : "DISCONNECTED");
+}
+
+// Notifies when a card was read.
+// Instead of a message, the seconds parameter can be anything you want -- Whatever you specify on `wiegand.onReceive()`
+void receivedData(uint8_t* data, uint8_t bits, const char* message) {
+    Serial.print(message);
+    Serial.print(bits);
+    Serial.print("bits / ");
+    //Print value in HEX
+    uint8_t bytes = (bits+7)/8;
+    for (int i=0; i<bytes; i++) {
+        Serial.print(data[i] >> 4, 16);
+        Serial.print(data[i] & 0xF, 16);
+    }
+    Serial.println();
+}
+
+// Notifies when an invalid transmission is detected
+void receivedDataError(Wiegand::DataError error, uint8_t* rawData, uint8_t rawBits, const char* message) {
+    Serial.print(message);
+    Serial.print(Wiegand::DataErrorStr(error));
+    Serial.print(" - Raw data: ");
+    Serial.print(rawBits);
+    Serial.print("bits / ");
+
+    //Print value in HEX
+    uint8_t bytes = (rawBits+7)/8;
+    for (int i=0; i<bytes; i++) {
+        Serial.print(rawData[i] >> 4, 16);
+        Serial.print(rawData[i] & 0xF, 16);
+    }
+    Serial.println();
+}
@@ -0,0 +1,387 @@
+/*
+ * Microbenchmarks for the per-edge hot path of the Wiegand decoder.
+ *
+ * Synthetic frames are fed through `setPinState()` under every `begin()` configuration,
+ * reporting the average cost per edge and per frame, and the worst case of the frame-completing call.
+ * `flushData()`, `align_data()` and both implementations of `updatePin()` are also measured in isolation.
+ *
+ * Usage: wiegand_bench [iterations]
+ */
+#include <Arduino.h>
+#include <Wiegand.h>
+#include <WiegandBits.h>
+#include <WiegandCore.h>
+#include <WiegandPort.h>
+#include <StaticWiegand.h>
+#include <InlineWiegand.h>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+typedef std::chrono::steady_clock Clock;
+
+static volatile uint32_t sink = 0;
+
+static double elapsedNs(Clock::time_point start, Clock::time_point end) {
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+static void onData(uint8_t* data, uint8_t bits, void*) {
+    sink += data[0] + bits;
+}
+
+static void onError(Wiegand::DataError error, uint8_t* data, uint8_t bits, void*) {
+    sink += data[0] + bits + error;
+}
+
+/**
+ * Pseudo-random frame of `bits` bits. 26 and 34-bit frames get valid parity bits.
+ */
+static std::string makeFrame(uint8_t bits, uint32_t seed) {
+    std::string frame;
+    for (int i=0; i<bits; i++) {
+        seed = seed * 1103515245 + 12345;
+        frame += (seed >> 16) & 1 ? '1' : '0';
+    }
+    if (bits == 26 || bits == 34) {
+        int left = 0, right = 1;
+        for (int i=1; i<bits/2; i++) {
+            left ^= frame[i] == '1';
+        }
+        for (int i=bits/2; i<bits-1; i++) {
+            right ^= frame[i] == '1';
+        }
+        frame[0] = left ? '1' : '0';
+        frame[bits-1] = right ? '1' : '0';
+    }
+    return frame;
+}
+
+template<typename Decoder>
+static void connect(Decoder& wiegand) {
+    wiegand.setPin0State(true);
+    wiegand.setPin1State(true);
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    wiegand.flush();
+}
+
+/**
+ * Feeds `iterations` frames to `wiegand` and measures the cost of each edge / frame
+ */
+template<typename Decoder>
+static void runEdges(Decoder& wiegand, const char* config, bool length_any, uint8_t bits, int iterations) {
+    connect(wiegand);
+
+    std::string frame = makeFrame(bits, bits);
+    double total = 0;
+    double worst_last_edge = 0;
+    for (int it=0; it<iterations; it++) {
+        Clock::time_point start = Clock::now();
+        for (int i=0; i<bits-1; i++) {
+            wiegand.setPinState(frame[i] == '1', false);
+            wiegand.setPinState(frame[i] == '1', true);
+        }
+        wiegand.setPinState(frame[bits-1] == '1', false);
+        Clock::time_point last_edge = Clock::now();
+        wiegand.setPinState(frame[bits-1] == '1', true);
+        if (length_any) {
+            wiegand.flushNow();
+        }
+        Clock::time_point end = Clock::now();
+
+        total += elapsedNs(start, end);
+        if (elapsedNs(last_edge, end) > worst_last_edge) {
+            worst_last_edge = elapsedNs(last_edge, end);
+        }
+    }
+
+    printf("%-20s %5d %12.1f %12.1f %14.1f\n", config, bits,
+        total / iterations / (2*bits), total / iterations, worst_last_edge);
+}
+
+/**
+ * Measures a `Wiegand` under the given `begin()` configuration
+ */
+static void benchEdges(uint8_t expected_bits, bool decode, uint8_t bits, int iterations) {
+    Wiegand wiegand = Wiegand();
+    wiegand.onReceive(onData, (void*)nullptr);
+    wiegand.onReceiveError(onError, (void*)nullptr);
+    wiegand.begin(expected_bits, decode);
+
+    char config[32];
+    snprintf(config, sizeof(config), "begin(%s, %s)",
+        expected_bits == Wiegand::LENGTH_ANY ? "ANY" : std::to_string(expected_bits).c_str(),
+        decode ? "true" : "false");
+    runEdges(wiegand, config, expected_bits == Wiegand::LENGTH_ANY, bits, iterations);
+}
+
+/**
+ * Measures a `StaticWiegand` with the given configuration
+ */
+template<uint8_t EXPECTED_BITS, bool DECODE_MESSAGES>
+static void benchStaticEdges(uint8_t bits, int iterations) {
+    StaticWiegand<EXPECTED_BITS, DECODE_MESSAGES> wiegand = StaticWiegand<EXPECTED_BITS, DECODE_MESSAGES>();
+    wiegand.onReceive(onData, (void*)nullptr);
+    wiegand.onReceiveError(onError, (void*)nullptr);
+    wiegand.begin();
+
+    char config[32];
+    snprintf(config, sizeof(config), "Static<%s, %s>",
+        EXPECTED_BITS == Wiegand::LENGTH_ANY ? "ANY" : std::to_string(EXPECTED_BITS).c_str(),
+        DECODE_MESSAGES ? "true" : "false");
+    runEdges(wiegand, config, EXPECTED_BITS == Wiegand::LENGTH_ANY, bits, iterations);
+}
+
+/**
+ * `InlineWiegand` with the same handlers as the other decoders
+ */
+class InlineBench : public InlineWiegand<InlineBench> {
+public:
+    void onReceive(uint8_t* data, uint8_t bits) {
+        onData(data, bits, nullptr);
+    }
+
+    void onReceiveError(Wiegand::DataError error, uint8_t* data, uint8_t bits) {
+        onError(error, data, bits, nullptr);
+    }
+};
+
+/**
+ * Measures an `InlineWiegand` under the given `begin()` configuration
+ */
+static void benchInlineEdges(uint8_t expected_bits, bool decode, uint8_t bits, int iterations) {
+    InlineBench wiegand;
+    wiegand.begin(expected_bits, decode);
+
+    char config[32];
+    snprintf(config, sizeof(config), "Inline(%s, %s)",
+        expected_bits == Wiegand::LENGTH_ANY ? "ANY" : std::to_string(expected_bits).c_str(),
+        decode ? "true" : "false");
+    runEdges(wiegand, config, expected_bits == Wiegand::LENGTH_ANY, bits, iterations);
+}
+
+/**
+ * Feeds frames the way an interruption handler does, reporting both pins on every change,
+ * so that half of the calls are for a pin that didn't change
+ */
+static void benchHandlerEdges(uint8_t bits, int iterations) {
+    Wiegand wiegand = Wiegand();
+    wiegand.onReceive(onData, (void*)nullptr);
+    wiegand.onReceiveError(onError, (void*)nullptr);
+    wiegand.begin(bits, true);
+    connect(wiegand);
+
+    std::string frame = makeFrame(bits, bits);
+    double total = 0;
+    for (int it=0; it<iterations; it++) {
+        Clock::time_point start = Clock::now();
+        for (int i=0; i<bits; i++) {
+            bool pin = frame[i] == '1';
+            wiegand.setPin0State(pin);
+            wiegand.setPin1State(!pin);
+            wiegand.setPin0State(true);
+            wiegand.setPin1State(true);
+        }
+        Clock::time_point end = Clock::now();
+        total += elapsedNs(start, end);
+    }
+    printf("handler(%2d, true)    %5d %12.1f %12.1f\n", bits, bits, total / iterations / (2*bits), total / iterations);
+}
+
+/**
+ * Measures `flushNow()` (i.e., `flushData()` + `reset()`) on a complete pending frame
+ */
+static void benchFlush(bool decode, uint8_t bits, int iterations) {
+    Wiegand wiegand = Wiegand();
+    wiegand.onReceive(onData, (void*)nullptr);
+    wiegand.onReceiveError(onError, (void*)nullptr);
+    wiegand.begin(Wiegand::LENGTH_ANY, decode);
+    connect(wiegand);
+
+    std::string frame = makeFrame(bits, bits);
+    double total = 0;
+    double worst = 0;
+    for (int it=0; it<iterations; it++) {
+        for (int i=0; i<bits; i++) {
+            wiegand.setPinState(frame[i] == '1', false);
+            wiegand.setPinState(frame[i] == '1', true);
+        }
+        Clock::time_point start = Clock::now();
+        wiegand.flushNow();
+        Clock::time_point end = Clock::now();
+        total += elapsedNs(start, end);
+        if (elapsedNs(start, end) > worst) {
+            worst = elapsedNs(start, end);
+        }
+    }
+    printf("flushData(%-5s)      %5d %12.1f %12.1f\n", decode ? "true" : "false", bits, total / iterations, worst);
+}
+
+/**
+ * Measures `align_data()` over the ranges used by the decoder
+ */
+static void benchAlign(uint8_t start_bit, uint8_t bits, int iterations) {
+    uint8_t pattern[Wiegand::MAX_BYTES];
+    uint8_t data[Wiegand::MAX_BYTES];
+    for (int i=0; i<Wiegand::MAX_BYTES; i++) {
+        pattern[i] = uint8_t(0x5A ^ (i * 37));
+    }
+
+    double total = 0;
+    double worst = 0;
+    for (int it=0; it<iterations; it++) {
+        memcpy(data, pattern, sizeof(data));
+        Clock::time_point start = Clock::now();
+        sink += align_data(data, start_bit, bits - start_bit);
+        Clock::time_point end = Clock::now();
+        sink += data[0];
+        total += elapsedNs(start, end);
+        if (elapsedNs(start, end) > worst) {
+            worst = elapsedNs(start, end);
+        }
+    }
+    printf("align_data(%2d, %2d)   %5d %12.1f %12.1f\n", start_bit, bits - start_bit, bits - 2*start_bit, total / iterations, worst);
+}
+
+/**
+ * Measures a pin change decoded with branches or with the transition table, over the edges of a frame
+ */
+static void benchUpdatePin(bool table, int iterations) {
+    std::string frame = makeFrame(34, 34);
+    uint8_t state = WiegandCore::PIN_0 | WiegandCore::PIN_1 | WiegandCore::DEVICE_CONNECTED | WiegandCore::DEVICE_INITIALIZED;
+    double total = 0;
+    double worst = 0;
+    for (int it=0; it<iterations; it++) {
+        for (int i=0; i<34; i++) {
+            for (int level=0; level<2; level++) {
+                Clock::time_point start = Clock::now();
+                sink += table ? WiegandCore::updatePinTable(state, frame[i] == '1', level)
+                              : WiegandCore::updatePinBranches(state, frame[i] == '1', level);
+                Clock::time_point end = Clock::now();
+                total += elapsedNs(start, end);
+                if (elapsedNs(start, end) > worst) {
+                    worst = elapsedNs(start, end);
+                }
+            }
+        }
+    }
+    printf("updatePin%-11s %5d %12.1f %12.1f\n", table ? "Table()" : "Branches()", 34, total / (68.0 * iterations), worst);
+}
+
+static void onPortData(uint8_t channel, uint8_t* data, uint8_t bits, void*) {
+    sink += channel + data[0] + bits;
+}
+
+static void onPortError(uint8_t channel, Wiegand::DataError error, uint8_t* data, uint8_t bits, void*) {
+    sink += channel + data[0] + bits + error;
+}
+
+/**
+ * Builds the port samples for 4 readers sending `bits`-bit frames at the same time, one bit per sample pair
+ */
+static std::string makePortSamples(uint8_t bits) {
+    std::string frames[4];
+    for (int channel=0; channel<4; channel++) {
+        frames[channel] = makeFrame(bits, bits + channel);
+    }
+    std::string samples;
+    for (int i=0; i<bits; i++) {
+        uint8_t low = 0xFF;
+        for (int channel=0; channel<4; channel++) {
+            low &= ~(1 << (2*channel + (frames[channel][i] == '1')));
+        }
+        samples += char(low);
+        samples += char(0xFF);
+    }
+    return samples;
+}
+
+/**
+ * Compares a `WiegandPort` against 4 `Wiegand` instances updated pin by pin, on the same port samples
+ */
+static void benchPort(uint8_t bits, int iterations) {
+    std::string samples = makePortSamples(bits);
+
+    WiegandPort<4> port;
+    port.onReceive(onPortData, (void*)nullptr);
+    port.onReceiveError(onPortError, (void*)nullptr);
+    port.begin(bits);
+    port.setPortState(0xFF);
+
+    Wiegand wiegand[4];
+    for (int channel=0; channel<4; channel++) {
+        wiegand[channel] = Wiegand();
+        wiegand[channel].onReceive(onData, (void*)nullptr);
+        wiegand[channel].onReceiveError(onError, (void*)nullptr);
+        wiegand[channel].begin(bits);
+        wiegand[channel].setPin0State(true);
+        wiegand[channel].setPin1State(true);
+    }
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    port.flush();
+    for (int channel=0; channel<4; channel++) {
+        wiegand[channel].flush();
+    }
+
+    double port_total = 0;
+    double pins_total = 0;
+    for (int it=0; it<iterations; it++) {
+        Clock::time_point start = Clock::now();
+        for (char sample : samples) {
+            port.setPortState(uint8_t(sample));
+        }
+        Clock::time_point middle = Clock::now();
+        for (char sample : samples) {
+            for (int channel=0; channel<4; channel++) {
+                wiegand[channel].setPin0State((uint8_t(sample) >> (2*channel)) & 1);
+                wiegand[channel].setPin1State((uint8_t(sample) >> (2*channel + 1)) & 1);
+            }
+        }
+        Clock::time_point end = Clock::now();
+        port_total += elapsedNs(start, middle);
+        pins_total += elapsedNs(middle, end);
+    }
+    printf("%-20s %5d %12.1f %12.1f\n", "4 readers / port", bits, port_total / iterations / samples.size(), port_total / iterations);
+    printf("%-20s %5d %12.1f %12.1f\n", "4 readers / pins", bits, pins_total / iterations / samples.size(), pins_total / iterations);
+}
+
+int main(int argc, char** argv) {
+    int iterations = argc > 1 ? atoi(argv[1]) : 20000;
+    static const uint8_t lengths[] = {26, 34, 37, 64};
+
+    printf("%-20s %5s %12s %12s %14s\n", "config", "bits", "ns/edge", "ns/frame", "max last edge");
+    for (uint8_t bits : lengths) {
+        benchEdges(bits, true, bits, iterations);
+        benchEdges(bits, false, bits, iterations);
+        benchEdges(Wiegand::LENGTH_ANY, true, bits, iterations);
+        benchEdges(Wiegand::LENGTH_ANY, false, bits, iterations);
+    }
+    benchStaticEdges<26, true>(26, iterations);
+    benchStaticEdges<34, true>(34, iterations);
+    benchStaticEdges<Wiegand::LENGTH_ANY, true>(34, iterations);
+    benchInlineEdges(26, true, 26, iterations);
+    benchInlineEdges(34, true, 34, iterations);
+    benchInlineEdges(Wiegand::LENGTH_ANY, true, 34, iterations);
+    benchHandlerEdges(26, iterations);
+    benchHandlerEdges(34, iterations);
+
+    printf("\n%-20s %5s %12s %12s\n", "call", "bits", "ns/call", "max ns");
+    for (uint8_t bits : lengths) {
+        benchFlush(true, bits, iterations);
+        benchFlush(false, bits, iterations);
+    }
+    for (uint8_t bits : lengths) {
+        benchAlign(0, bits, iterations);
+        benchAlign(1, bits, iterations);
+    }
+    benchUpdatePin(false, iterations);
+    benchUpdatePin(true, iterations);
+
+    printf("\n%-20s %5s %12s %12s\n", "decoder", "bits", "ns/sample", "ns/frame");
+    for (uint8_t bits : lengths) {
+        benchPort(bits, iterations);
+    }
+    return 0;
+}
@@ -0,0 +1,33 @@
+#include <Arduino.h>
+#include <HostTimer.h>
+
+static unsigned long now_micros = 0;
+
+uint8_t host_sreg = 0x80;
+
+void HostClock::set(unsigned long micros) {
+    now_micros = micros;
+}
+
+void HostClock::advance(unsigned long micros) {
+    unsigned long target = now_micros + micros;
+    //Simulated timers expiring on the way fire at their deadlines
+    HostTimer::runUntil(target);
+    now_micros = target;
+}
+
+unsigned long millis() {
+    return now_micros / 1000UL;
+}
+
+unsigned long micros() {
+    return now_micros;
+}
+
+void delay(unsigned long ms) {
+    HostClock::advanceMillis(ms);
+}
+
+void delayMicroseconds(unsigned int us) {
+    HostClock::advance(us);
+}
@@ -0,0 +1,69 @@
+/*
+ * Minimal stand-in for the Arduino core, used to build and test the library on a desktop machine.
+ *
+ * Only the bits used by this library are provided. Time does not flow by itself:
+ * `millis()` and `micros()` read a virtual clock which is moved around with `HostClock`.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef bool boolean;
+
+#define LOW  0
+#define HIGH 1
+
+/**
+ * Virtual clock backing `millis()` and `micros()`
+ */
+namespace HostClock {
+    /**
+     * Sets the current time, in microseconds
+     */
+    void set(unsigned long micros);
+
+    /**
+     * Moves the clock forward by `micros` microseconds, firing any `HostTimer` that expires on the way
+     */
+    void advance(unsigned long micros);
+
+    /**
+     * Moves the clock forward by `millis` milliseconds
+     */
+    inline void advanceMillis(unsigned long millis) {
+        advance(millis * 1000UL);
+    }
+}
+
+unsigned long millis();
+unsigned long micros();
+
+/**
+ * Moves the virtual clock forward, instead of actually sleeping
+ */
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+/**
+ * There are no interruptions on the host, but whether they are enabled is tracked
+ * on an emulated AVR status register, so that code saving and restoring it can be tested
+ */
+extern uint8_t host_sreg;
+#define SREG host_sreg
+
+inline void noInterrupts() {
+    SREG &= 0x7F;
+}
+
+inline void interrupts() {
+    SREG |= 0x80;
+}
+
+/**
+ * Flash and RAM are the same thing on the host
+ */
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define memcpy_P memcpy
@@ -0,0 +1,48 @@
+#include <HostTimer.h>
+
+HostTimer* HostTimer::timers = nullptr;
+
+HostTimer::HostTimer() : armed(false), deadline(0), start_count(0), expire_count(0), func_expire(nullptr), func_expire_param(nullptr) {
+    next = timers;
+    timers = this;
+}
+
+HostTimer::~HostTimer() {
+    for (HostTimer** timer = &timers; *timer; timer = &(*timer)->next) {
+        if (*timer == this) {
+            *timer = next;
+            break;
+        }
+    }
+}
+
+void HostTimer::start(unsigned long micros) {
+    deadline = ::micros() + micros;
+    armed = true;
+    start_count++;
+}
+
+void HostTimer::stop() {
+    armed = false;
+}
+
+void HostTimer::runUntil(unsigned long target) {
+    while (true) {
+        //Earliest deadline up to `target`
+        HostTimer* earliest = nullptr;
+        for (HostTimer* timer = timers; timer; timer = timer->next) {
+            if (timer->armed && long(target - timer->deadline) >= 0 && (!earliest || long(earliest->deadline - timer->deadline) > 0)) {
+                earliest = timer;
+            }
+        }
+        if (!earliest) {
+            return;
+        }
+        HostClock::set(earliest->deadline);
+        earliest->armed = false;
+        earliest->expire_count++;
+        if (earliest->func_expire) {
+            earliest->func_expire(earliest->func_expire_param);
+        }
+    }
+}
@@ -0,0 +1,72 @@
+/*
+ * Simulated one-shot hardware timer for the host build.
+ *
+ * It runs on the virtual clock of `HostClock`: When the clock is moved past the deadline
+ * of a running timer, the clock stops at the deadline and the timer's callback is called,
+ * just like a compare-match interruption would.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+class HostTimer {
+public:
+    typedef void (*callback)(void* param);
+
+    HostTimer();
+    ~HostTimer();
+
+    /**
+     * Sets the function called when the timer expires
+     */
+    template<typename T> void onExpire(void (*func)(T* param), T* param=nullptr) {
+        func_expire = (callback)func;
+        func_expire_param = (void*)param;
+    }
+
+    /**
+     * (Re)starts the timer, to expire `micros` microseconds from now
+     */
+    void start(unsigned long micros);
+
+    /**
+     * Stops the timer, if it is running
+     */
+    void stop();
+
+    inline bool running() const {
+        return armed;
+    }
+
+    /**
+     * Number of times the timer was started
+     */
+    inline unsigned long starts() const {
+        return start_count;
+    }
+
+    /**
+     * Number of times the timer has expired
+     */
+    inline unsigned long expirations() const {
+        return expire_count;
+    }
+
+    /**
+     * Fires all timers whose deadline is up to `target`, in order, moving the clock to each deadline.
+     *
+     * Used by `HostClock::advance()`.
+     */
+    static void runUntil(unsigned long target);
+
+private:
+    bool armed;
+    unsigned long deadline;
+    unsigned long start_count;
+    unsigned long expire_count;
+    callback func_expire;
+    void* func_expire_param;
+    HostTimer* next;
+
+    static HostTimer* timers;
+};
@@ -0,0 +1,48 @@
+#include "harness.h"
+
+namespace harness {
+    struct Test {
+        const char* name;
+        test_func func;
+    };
+
+    static Test tests[256];
+    static int test_count = 0;
+    static int failures = 0;
+
+    Registration::Registration(const char* name, test_func func) {
+        tests[test_count].name = name;
+        tests[test_count].func = func;
+        test_count++;
+    }
+
+    void fail(const char* file, int line, const char* expr) {
+        printf("  %s:%d: CHECK failed: %s\n", file, line, expr);
+        failures++;
+    }
+}
+
+int main(int argc, char** argv) {
+    using namespace harness;
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    int failed_tests = 0;
+    int ran = 0;
+
+    for (int i=0; i<test_count; i++) {
+        if (filter && !strstr(tests[i].name, filter)) {
+            continue;
+        }
+        int failures_before = failures;
+        tests[i].func();
+        ran++;
+        if (failures != failures_before) {
+            printf("FAIL %s\n", tests[i].name);
+            failed_tests++;
+        } else {
+            printf("ok   %s\n", tests[i].name);
+        }
+    }
+
+    printf("%d tests, %d failed\n", ran, failed_tests);
+    return failed_tests ? 1 : 0;
+}
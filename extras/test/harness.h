@@ -0,0 +1,34 @@
+/*
+ * Tiny self-contained test harness for the host build.
+ *
+ * Tests are declared with `TEST(name) { ... }` and register themselves before `main()` runs.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+namespace harness {
+    typedef void (*test_func)();
+
+    struct Registration {
+        Registration(const char* name, test_func func);
+    };
+
+    /**
+     * Reports a failed check. The current test keeps running.
+     */
+    void fail(const char* file, int line, const char* expr);
+}
+
+#define TEST(name) \
+    static void test_##name(); \
+    static harness::Registration registration_##name(#name, test_##name); \
+    static void test_##name()
+
+#define CHECK(expr) \
+    do { if (!(expr)) harness::fail(__FILE__, __LINE__, #expr); } while (0)
+
+#define CHECK_EQUAL(expected, actual) \
+    do { if (!((expected) == (actual))) harness::fail(__FILE__, __LINE__, #expected " == " #actual); } while (0)
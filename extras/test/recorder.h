@@ -0,0 +1,84 @@
+/*
+ * Helpers to drive a `Wiegand` instance and record everything it reports
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <Wiegand.h>
+#include <string>
+#include <vector>
+
+/**
+ * Formats a payload as "<bits>:<hex bytes>", e.g. "24:0a1b2c"
+ */
+inline std::string formatPayload(const uint8_t* data, uint16_t bits) {
+    static const char hex[] = "0123456789abcdef";
+    std::string ret = std::to_string(bits) + ":";
+    for (int i=0; i<(bits+7)/8; i++) {
+        ret += hex[data[i] >> 4];
+        ret += hex[data[i] & 0xF];
+    }
+    return ret;
+}
+
+/**
+ * Collects all callbacks sent by a `Wiegand` instance, in order.
+ *
+ * Data is recorded as "<bits>:<hex>", errors as "<error>!<bits>:<hex>" and
+ * state changes as "+" / "-"
+ */
+struct Recorder {
+    std::vector<std::string> events;
+
+    template<typename Decoder> void attach(Decoder& wiegand) {
+        wiegand.onReceive(onData, this);
+        wiegand.onReceiveError(onError, this);
+        wiegand.onStateChange(onState, this);
+    }
+
+    std::string last() const {
+        return events.empty() ? std::string() : events.back();
+    }
+
+    template<typename bits_t> static void onData(uint8_t* data, bits_t bits, Recorder* self) {
+        self->events.push_back(formatPayload(data, bits));
+    }
+
+    template<typename bits_t> static void onError(Wiegand::DataError error, uint8_t* data, bits_t bits, Recorder* self) {
+        self->events.push_back(std::to_string(int(error)) + "!" + formatPayload(data, bits));
+    }
+
+    static void onState(bool plugged, Recorder* self) {
+        self->events.push_back(plugged ? "+" : "-");
+    }
+};
+
+/**
+ * Plugs a reader and waits for the connection to settle, so that the next bits are accepted
+ */
+template<typename Decoder> inline void connectReader(Decoder& wiegand) {
+    wiegand.setPin0State(true);
+    wiegand.setPin1State(true);
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    wiegand.flush();
+}
+
+/**
+ * Sends a frame written as a string of '0' and '1', with a realistic 2ms bit interval
+ */
+template<typename Decoder> inline void sendFrame(Decoder& wiegand, const char* bits) {
+    for (const char* c = bits; *c; c++) {
+        wiegand.setPinState(*c == '1', false);
+        HostClock::advance(50);
+        wiegand.setPinState(*c == '1', true);
+        HostClock::advance(1950);
+    }
+}
+
+/**
+ * Waits for the end-of-message timeout and flushes the pending message
+ */
+template<typename Decoder> inline void finishFrame(Decoder& wiegand) {
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    wiegand.flush();
+}
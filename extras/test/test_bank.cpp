@@ -0,0 +1,182 @@
+#include "harness.h"
+#include "recorder.h"
+#include <WiegandBank.h>
+#include <new>
+
+/**
+ * Collects callbacks from all channels of a bank, using the same format as `Recorder`
+ */
+struct BankRecorder {
+    std::vector<std::string> events[4];
+
+    template<uint8_t N, uint16_t MAX_BITS, typename bits_t> void attach(WiegandBank<N, MAX_BITS, bits_t>& bank) {
+        bank.onReceive(onData, this);
+        bank.onReceiveError(onError, this);
+        bank.onStateChange(onState, this);
+    }
+
+    template<typename bits_t> static void onData(uint8_t channel, uint8_t* data, bits_t bits, BankRecorder* self) {
+        self->events[channel].push_back(formatPayload(data, bits));
+    }
+
+    template<typename bits_t> static void onError(uint8_t channel, Wiegand::DataError error, uint8_t* data, bits_t bits, BankRecorder* self) {
+        self->events[channel].push_back(std::to_string(int(error)) + "!" + formatPayload(data, bits));
+    }
+
+    static void onState(uint8_t channel, bool plugged, BankRecorder* self) {
+        self->events[channel].push_back(plugged ? "+" : "-");
+    }
+};
+
+TEST(bank_channels) {
+    WiegandBank<3> bank;
+    BankRecorder recorder;
+    recorder.attach(bank);
+    bank.begin();
+
+    for (uint8_t channel=0; channel<3; channel++) {
+        bank.setPin0State(channel, true);
+        bank.setPin1State(channel, true);
+        CHECK(bank.connected(channel));
+    }
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    bank.flush();
+
+    //Interleaved messages on channels 0 and 2
+    const char* message0 = "0110";
+    const char* message2 = "10000001";
+    for (int i=0; i<8; i++) {
+        if (i < 4) {
+            bank.setPinState(0, message0[i] == '1', false);
+            bank.setPinState(0, message0[i] == '1', true);
+        }
+        bank.setPinState(2, message2[i] == '1', false);
+        bank.setPinState(2, message2[i] == '1', true);
+        HostClock::advanceMillis(2);
+    }
+    bank.flush();
+    CHECK_EQUAL(1u, recorder.events[0].size());
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    bank.flush();
+
+    CHECK_EQUAL(std::string("4:06"), recorder.events[0].back());
+    CHECK_EQUAL(1u, recorder.events[1].size());
+    CHECK_EQUAL(std::string("4!8:81"), recorder.events[2].back());
+
+    bank.setPin0State(1, false);
+    bank.setPin1State(1, false);
+    CHECK(!bank.connected(1));
+    CHECK_EQUAL(std::string("-"), recorder.events[1].back());
+}
+
+TEST(bank_matches_wiegand) {
+    const uint8_t N = 4;
+    WiegandBank<N> bank;
+    BankRecorder bank_recorder;
+    bank_recorder.attach(bank);
+    bank.begin(Wiegand::LENGTH_ANY);
+
+    Wiegand wiegand[N];
+    Recorder recorder[N];
+    for (uint8_t channel=0; channel<N; channel++) {
+        wiegand[channel] = Wiegand();
+        recorder[channel].attach(wiegand[channel]);
+        wiegand[channel].begin(Wiegand::LENGTH_ANY);
+    }
+
+    //Random pin changes, mostly well-formed bits, with random gaps
+    uint32_t seed = 42;
+    for (int step=0; step<20000; step++) {
+        seed = seed * 1103515245 + 12345;
+        uint8_t channel = (seed >> 8) % N;
+        uint8_t pin = (seed >> 12) & 1;
+        bool level = ((seed >> 13) & 7) != 0;
+        HostClock::advance(((seed >> 16) & 0xFF) == 0 ? 40000 : (seed >> 16) % 500);
+
+        bank.setPinState(channel, pin, level);
+        wiegand[channel].setPinState(pin, level);
+        //Leaving a pin low now and then also produces disconnections and truncated messages
+        if (!level && ((seed >> 24) & 31) != 0) {
+            bank.setPinState(channel, pin, true);
+            wiegand[channel].setPinState(pin, true);
+        }
+        if (step % 64 == 0) {
+            bank.flush();
+            for (uint8_t i=0; i<N; i++) {
+                wiegand[i].flush();
+            }
+        }
+    }
+
+    for (uint8_t channel=0; channel<N; channel++) {
+        CHECK(recorder[channel].events.size() > 10);
+        CHECK(recorder[channel].events == bank_recorder.events[channel]);
+    }
+}
+
+TEST(bank_large_frames) {
+    WiegandBank<2, 128> bank;
+    BankRecorder recorder;
+    recorder.attach(bank);
+    bank.begin(Wiegand::LENGTH_ANY, false);
+    bank.setPin0State(1, true);
+    bank.setPin1State(1, true);
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    bank.flush();
+
+    //128 bits: 0x00, 0x01, ... 0x0f
+    for (int i=0; i<128; i++) {
+        bool bit = ((i / 8) >> (7 - i % 8)) & 1;
+        bank.setPinState(1, bit, false);
+        bank.setPinState(1, bit, true);
+        HostClock::advanceMillis(2);
+    }
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    bank.flush();
+    CHECK_EQUAL(std::string("128:000102030405060708090a0b0c0d0e0f"), recorder.events[1].back());
+}
+
+TEST(bank_over_255_bits) {
+    //With a 16-bit counter, reaching 255 bits isn't reaching `LENGTH_ANY`
+    WiegandBank<1, 300, uint16_t> bank;
+    BankRecorder recorder;
+    recorder.attach(bank);
+    bank.begin(Wiegand::LENGTH_ANY, false);
+    bank.setPin0State(0, true);
+    bank.setPin1State(0, true);
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    bank.flush();
+
+    for (int i=0; i<280; i++) {
+        bank.setPinState(0, i & 1, false);
+        bank.setPinState(0, i & 1, true);
+        HostClock::advanceMillis(2);
+    }
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    bank.flush();
+    CHECK_EQUAL(2u, recorder.events[0].size());
+    CHECK_EQUAL(std::string("280:"), recorder.events[0].back().substr(0, 4));
+}
+
+TEST(bank_constructor) {
+    //Instances that aren't globals start on whatever was in memory
+    alignas(WiegandBank<2>) uint8_t memory[sizeof(WiegandBank<2>)];
+    memset(memory, 0xA5, sizeof(memory));
+    WiegandBank<2>* bank = new (memory) WiegandBank<2>;
+    CHECK(!bank->connected(0));
+    CHECK(!bank->connected(1));
+    unsigned long deadline;
+    CHECK(!bank->nextDeadline(deadline));
+
+    //No callbacks attached: Nothing to call
+    bank->begin();
+    bank->setPin0State(0, true);
+    bank->setPin1State(0, true);
+    bank->setPin0State(0, false);
+    bank->setPin0State(0, true);
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    bank->flush();
+    CHECK(bank->connected(0));
+    CHECK(!bank->connected(1));
+    bank->~WiegandBank<2>();
+}
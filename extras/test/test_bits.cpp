@@ -0,0 +1,47 @@
+#include "harness.h"
+#include <Wiegand.h>
+#include <WiegandBits.h>
+
+/**
+ * The original bit-by-bit implementation of `align_data`, used as reference
+ */
+static uint8_t align_data_reference(uint8_t* data, uint8_t start, uint8_t end) {
+    uint8_t aligned_data[Wiegand::MAX_BYTES];
+    uint8_t aligned_bits = end - start;
+    uint8_t aligned_bytes = (aligned_bits + 7)/8;
+    uint8_t aligned_offset = 8*aligned_bytes - aligned_bits;
+
+    aligned_data[0] = 0;
+    for (int bit=0; bit<aligned_bits; bit++) {
+        writeBit(aligned_data, bit + aligned_offset, readBit(data, bit+start));
+    }
+    for (int i=0; i<aligned_bytes; i++) {
+        data[i] = aligned_data[i];
+    }
+    return aligned_bits;
+}
+
+TEST(align_data_matches_reference) {
+    uint32_t seed = 1;
+    for (int pattern=0; pattern<16; pattern++) {
+        uint8_t input[Wiegand::MAX_BYTES];
+        for (int i=0; i<Wiegand::MAX_BYTES; i++) {
+            seed = seed * 1103515245 + 12345;
+            input[i] = pattern == 0 ? 0xFF : uint8_t(seed >> 16);
+        }
+
+        for (int start=0; start<=Wiegand::MAX_BITS; start++) {
+            for (int end=start; end<=Wiegand::MAX_BITS; end++) {
+                uint8_t expected[Wiegand::MAX_BYTES];
+                uint8_t actual[Wiegand::MAX_BYTES];
+                memcpy(expected, input, sizeof(input));
+                memcpy(actual, input, sizeof(input));
+
+                uint8_t expected_bits = align_data_reference(expected, start, end);
+                uint8_t actual_bits = align_data(actual, start, end);
+                CHECK_EQUAL(expected_bits, actual_bits);
+                CHECK(memcmp(expected, actual, sizeof(input)) == 0);
+            }
+        }
+    }
+}
@@ -0,0 +1,148 @@
+#include "harness.h"
+#include "recorder.h"
+#include <CompactWiegand.h>
+
+/**
+ * Records the events of a `CompactWiegand` in the same format as `Recorder`
+ */
+struct CompactRecorder {
+    std::vector<std::string> events;
+
+    template<uint8_t MAX_BITS> void attach(CompactWiegand<MAX_BITS>& wiegand) {
+        wiegand.onEvent(onEvent<MAX_BITS>, this);
+    }
+
+    std::string last() const {
+        return events.empty() ? std::string() : events.back();
+    }
+
+    template<uint8_t MAX_BITS>
+    static void onEvent(typename CompactWiegand<MAX_BITS>::Event event, uint8_t* data, uint8_t bits, CompactRecorder* self) {
+        typedef CompactWiegand<MAX_BITS> Compact;
+        if (event == Compact::Connected) {
+            self->events.push_back("+");
+        } else if (event == Compact::Disconnected) {
+            self->events.push_back("-");
+        } else if (Compact::isError(event)) {
+            self->events.push_back(std::to_string(int(Compact::dataError(event))) + "!" + formatPayload(data, bits));
+        } else {
+            self->events.push_back(formatPayload(data, bits));
+        }
+    }
+};
+
+/**
+ * Feeds the same random messages (of common sizes, with random content and sometimes
+ * random interruptions) to a `CompactWiegand` and to a `Wiegand` with the same configuration
+ */
+static void checkCompactMatchesWiegand(uint8_t expected_bits, bool decode_messages, uint32_t seed) {
+    static const uint8_t sizes[] = {4, 8, 26, 34, 37, 70};
+
+    CompactWiegand<> compact;
+    CompactRecorder compact_recorder;
+    compact_recorder.attach(compact);
+    compact.begin(expected_bits, decode_messages);
+
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin(expected_bits, decode_messages);
+
+    for (int message=0; message<2000; message++) {
+        seed = seed * 1103515245 + 12345;
+        uint8_t bits = sizes[(seed >> 16) % 6];
+        for (uint8_t i=0; i<bits; i++) {
+            seed = seed * 1103515245 + 12345;
+            uint8_t pin = (seed >> 16) & 1;
+            //Now and then, a pin goes low without returning, or a message is cut short
+            bool glitch = ((seed >> 20) & 255) == 0;
+            compact.setPinState(pin, false);
+            wiegand.setPinState(pin, false);
+            if (!glitch) {
+                compact.setPinState(pin, true);
+                wiegand.setPinState(pin, true);
+            }
+            HostClock::advance(((seed >> 24) & 63) == 0 ? 30000 : 2000);
+        }
+        compact.setPinState(0, true);
+        compact.setPinState(1, true);
+        wiegand.setPinState(0, true);
+        wiegand.setPinState(1, true);
+        HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+        compact.flush();
+        wiegand.flush();
+    }
+
+    CHECK(recorder.events.size() > 100);
+    CHECK(recorder.events == compact_recorder.events);
+}
+
+TEST(compact_matches_wiegand) {
+    checkCompactMatchesWiegand(Wiegand::LENGTH_ANY, true, 1);
+    checkCompactMatchesWiegand(Wiegand::LENGTH_ANY, false, 2);
+    checkCompactMatchesWiegand(26, true, 3);
+    checkCompactMatchesWiegand(34, false, 4);
+    checkCompactMatchesWiegand(4, true, 5);
+}
+
+TEST(compact_timestamp_wraps) {
+    CompactWiegand<> compact;
+    CompactRecorder recorder;
+    recorder.attach(compact);
+
+    //The 16-bit timestamp wraps in the middle of the message
+    HostClock::set(65500UL * 1000);
+    compact.begin();
+    connectReader(compact);
+    CHECK(compact);
+    sendFrame(compact, "0000000000000000000000000000000000000000");
+    CHECK(millis() > 0x10000UL);
+    compact.flush();
+    CHECK_EQUAL(std::string("+"), recorder.last());
+    finishFrame(compact);
+    CHECK_EQUAL(std::string("3!40:0000000000"), recorder.last());
+
+    //Disconnection
+    compact.setPin0State(false);
+    compact.setPin1State(false);
+    CHECK(!compact);
+    CHECK_EQUAL(std::string("-"), recorder.last());
+}
+
+TEST(compact_long_idle) {
+    CompactWiegand<> compact;
+    CompactRecorder recorder;
+    recorder.attach(compact);
+    compact.begin();
+
+    //Nobody calls `flush()`: The reader settles when the first card comes, after a gap that doesn't fit in 15 bits
+    compact.setPin0State(true);
+    compact.setPin1State(true);
+    unsigned long deadline;
+    CHECK(!compact.nextDeadline(deadline));
+    for (unsigned long idle : {40000UL, 20000UL, 60000UL}) {
+        HostClock::advanceMillis(idle);
+        sendFrame(compact, "10000000100000000000000100");
+        CHECK(compact.nextDeadline(deadline));
+        HostClock::set(deadline * 1000UL);
+        compact.flush();
+        CHECK_EQUAL(std::string("24:010002"), recorder.last());
+        CHECK(!compact.nextDeadline(deadline));
+    }
+
+    //A deadline that was missed long ago is due right away
+    sendFrame(compact, "0110");
+    HostClock::advanceMillis(40000);
+    CHECK(compact.nextDeadline(deadline));
+    CHECK_EQUAL(millis(), deadline);
+    compact.flush();
+    CHECK_EQUAL(std::string("4:06"), recorder.last());
+}
+
+TEST(compact_size) {
+    CHECK(sizeof(CompactWiegand<>) < sizeof(Wiegand));
+    //Without padding (as on AVRs), RAM follows the buffer size
+    CHECK_EQUAL(CompactWiegand<>::PACKED_SIZE - 4, CompactWiegand<26>::PACKED_SIZE);
+    CHECK(CompactWiegand<>::PACKED_SIZE <= sizeof(CompactWiegand<>));
+    CHECK_EQUAL(4, CompactWiegand<26>::MAX_BYTES);
+}
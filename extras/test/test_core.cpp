@@ -0,0 +1,44 @@
+#include "harness.h"
+#include <WiegandCore.h>
+
+using namespace WiegandCore;
+
+TEST(transition_table_matches_branches) {
+    //Every state byte, pin and level
+    for (int initial=0; initial<256; initial++) {
+        for (uint8_t pin=0; pin<2; pin++) {
+            for (int level=0; level<2; level++) {
+                uint8_t branches_state = uint8_t(initial);
+                uint8_t table_state = uint8_t(initial);
+                PinEvent branches_event = updatePinBranches(branches_state, pin, level);
+                PinEvent table_event = updatePinTable(table_state, pin, level);
+                CHECK_EQUAL(branches_event, table_event);
+                CHECK_EQUAL(branches_state, table_state);
+            }
+        }
+    }
+}
+
+TEST(transition_table_sequences) {
+    //Random pin changes, with disconnections flushed as the decoders do
+    uint8_t branches_state = 0, table_state = 0;
+    uint32_t seed = 42;
+    for (int step=0; step<100000; step++) {
+        seed = seed * 1103515245 + 12345;
+        uint8_t pin = (seed >> 16) & 1;
+        bool level = (seed >> 17) & 1;
+        PinEvent branches_event = updatePinBranches(branches_state, pin, level);
+        PinEvent table_event = updatePinTable(table_state, pin, level);
+        CHECK_EQUAL(branches_event, table_event);
+        if (branches_event == DeviceDisconnected) {
+            setDisconnected(branches_state);
+            setDisconnected(table_state);
+        }
+        if (((seed >> 20) & 15) == 0) {
+            uint8_t bits = 0;
+            resetMessage(branches_state, bits);
+            resetMessage(table_state, bits);
+        }
+        CHECK_EQUAL(branches_state, table_state);
+    }
+}
@@ -0,0 +1,195 @@
+#include "harness.h"
+#include "recorder.h"
+#include <DeferredWiegand.h>
+#include <WiegandTiming.h>
+
+template<uint8_t N>
+static void queueFrame(DeferredWiegand<N>& wiegand, const char* bits) {
+    for (const char* c = bits; *c; c++) {
+        wiegand.queuePinState(*c == '1', false);
+        HostClock::advance(50);
+        wiegand.queuePinState(*c == '1', true);
+        HostClock::advance(1950);
+    }
+}
+
+TEST(deferred_decodes_on_process) {
+    DeferredWiegand<> wiegand = DeferredWiegand<>();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin(4);
+    wiegand.queuePin0State(true);
+    wiegand.queuePin1State(true);
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    wiegand.process();
+    CHECK_EQUAL(std::string("+"), recorder.last());
+
+    queueFrame(wiegand, "1001");
+    CHECK_EQUAL(8, wiegand.pending());
+    CHECK_EQUAL(std::string("+"), recorder.last());
+
+    wiegand.process();
+    CHECK_EQUAL(0, wiegand.pending());
+    CHECK_EQUAL(std::string("4:09"), recorder.last());
+}
+
+TEST(deferred_keeps_edge_timing) {
+    DeferredWiegand<> wiegand = DeferredWiegand<>();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin();
+    wiegand.queuePin0State(true);
+    wiegand.queuePin1State(true);
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    wiegand.process();
+
+    //Two messages queued with a gap between them, processed at once, must not be merged
+    queueFrame(wiegand, "0011");
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    queueFrame(wiegand, "0101");
+    wiegand.process();
+    CHECK_EQUAL(2u, recorder.events.size());
+    CHECK_EQUAL(std::string("4:03"), recorder.last());
+
+    //The last one is only sent after it times out
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    wiegand.process();
+    CHECK_EQUAL(std::string("4:05"), recorder.last());
+}
+
+TEST(deferred_overflow) {
+    DeferredWiegand<16> wiegand = DeferredWiegand<16>();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin();
+    wiegand.queuePin0State(true);
+    wiegand.queuePin1State(true);
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    wiegand.process();
+
+    //Only 8 bits fit, the last change marking where the rest were lost
+    queueFrame(wiegand, "0101010101");
+    CHECK_EQUAL(16, wiegand.pending());
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    wiegand.process();
+    CHECK_EQUAL(std::string("0!8:55"), recorder.last());
+
+    //Next message is fine
+    queueFrame(wiegand, "0110");
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    wiegand.process();
+    CHECK_EQUAL(std::string("4:06"), recorder.last());
+}
+
+TEST(deferred_skips_unchanged_pins) {
+    DeferredWiegand<16> wiegand = DeferredWiegand<16>();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin(Wiegand::LENGTH_ANY, false);
+    wiegand.queuePin0State(true);
+    wiegand.queuePin1State(true);
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    wiegand.process();
+
+    //An interrupt handler reading both pins on every change only takes room for the one that changed
+    const char* frame = "0110100";
+    for (const char* c = frame; *c; c++) {
+        for (int level = 0; level < 2; level++) {
+            wiegand.queuePin0State(*c == '1' || level);
+            wiegand.queuePin1State(*c == '0' || level);
+            HostClock::advance(level ? 1950 : 50);
+        }
+    }
+    CHECK_EQUAL(14, wiegand.pending());
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    wiegand.process();
+    CHECK_EQUAL(std::string("7:34"), recorder.last());
+}
+
+TEST(deferred_overflow_resync) {
+    DeferredWiegand<16> wiegand = DeferredWiegand<16>();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin();
+    wiegand.queuePin0State(true);
+    wiegand.queuePin1State(true);
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    wiegand.process();
+
+    //The queue fills up, and D0 going low is lost
+    queueFrame(wiegand, "01010101");
+    wiegand.queuePin0State(false);
+    CHECK_EQUAL(16, wiegand.pending());
+    wiegand.process();
+    CHECK_EQUAL(std::string("+"), recorder.last());
+
+    //The next change carries it along: Both pins are low, so the reader was unplugged
+    wiegand.queuePin1State(false);
+    wiegand.process();
+    CHECK_EQUAL(3u, recorder.events.size());
+    CHECK_EQUAL(std::string("0!8:55"), recorder.events[1]);
+    CHECK_EQUAL(std::string("-"), recorder.last());
+}
+
+TEST(deferred_overflow_after_gap) {
+    DeferredWiegand<16> wiegand = DeferredWiegand<16>();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin(Wiegand::LENGTH_ANY, false);
+    wiegand.queuePin0State(true);
+    wiegand.process();
+
+    //A complete message fills the queue, but for the last slot
+    wiegand.queuePin1State(true);
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    queueFrame(wiegand, "1011001");
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+
+    //The first change of the next message takes it, and the 2 after it are lost
+    wiegand.queuePinState(1, false);
+    HostClock::advance(50);
+    wiegand.queuePinState(1, true);
+    HostClock::advance(1950);
+    wiegand.queuePinState(0, false);
+    CHECK_EQUAL(16, wiegand.pending());
+    wiegand.process();
+    CHECK_EQUAL(std::string("7:59"), recorder.last());
+
+    //The message that lost them is the one reported as corrupted
+    HostClock::advance(50);
+    wiegand.queuePinState(0, true);
+    HostClock::advance(1950);
+    queueFrame(wiegand, "10");
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    wiegand.process();
+    CHECK_EQUAL(3u, recorder.events.size());
+    CHECK_EQUAL(std::string("0!3:06"), recorder.last());
+}
+
+TEST(deferred_microsecond_edges) {
+    DeferredWiegand<> wiegand = DeferredWiegand<>();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    WiegandTiming timing;
+    timing.setTimeouts(Wiegand::TIMEOUT * 1000UL, 0, Wiegand::TIMEOUT * 1000UL, true);
+    timing.setPulseLimits(20);
+    wiegand.setTiming(&timing);
+    wiegand.begin(4);
+    wiegand.queuePin0State(true);
+    wiegand.queuePin1State(true);
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    wiegand.process();
+    CHECK_EQUAL(std::string("+"), recorder.last());
+
+    //Edges are recorded with their time in microseconds, so a 5us spike is told apart from the 50us bits
+    queueFrame(wiegand, "10");
+    wiegand.queuePinState(1, false);
+    HostClock::advance(5);
+    wiegand.queuePinState(1, true);
+    HostClock::advance(1000);
+    queueFrame(wiegand, "01");
+    wiegand.process();
+    CHECK_EQUAL(2u, recorder.events.size());
+    CHECK_EQUAL(std::string("4:09"), recorder.last());
+    CHECK_EQUAL(1ul, timing.rejectedPulses());
+}
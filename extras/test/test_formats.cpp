@@ -0,0 +1,445 @@
+#include "harness.h"
+#include "recorder.h"
+#include <StaticWiegand.h>
+#include <WiegandBank.h>
+#include <WiegandFormats.h>
+
+/**
+ * A parity bit, described the way format specs do: Its position, and which other bits it covers
+ */
+struct ParitySpec {
+    int position;
+    bool odd;
+    bool (*covers)(int position);
+};
+
+/**
+ * Builds a frame from its fields, then fills the parity bits in order
+ */
+static std::string encode(int bits, int facility_offset, int facility_bits, uint64_t facility,
+                          int card_offset, int card_bits, uint64_t card,
+                          const ParitySpec* parity, int parity_count) {
+    std::string frame(bits, '0');
+    for (int i=0; i<facility_bits; i++) {
+        frame[facility_offset + i] = (facility >> (facility_bits - 1 - i)) & 1 ? '1' : '0';
+    }
+    for (int i=0; i<card_bits; i++) {
+        frame[card_offset + i] = (card >> (card_bits - 1 - i)) & 1 ? '1' : '0';
+    }
+    for (int p=0; p<parity_count; p++) {
+        bool value = parity[p].odd;
+        for (int i=0; i<bits; i++) {
+            if (i != parity[p].position && parity[p].covers(i) && frame[i] == '1') {
+                value = !value;
+            }
+        }
+        frame[parity[p].position] = value ? '1' : '0';
+    }
+    return frame;
+}
+
+/**
+ * Expected data callback output: Bits `offset` to `offset+width` of the frame, aligned to the right
+ */
+static std::string payloadOf(const std::string& frame, int offset, int width) {
+    uint8_t data[Wiegand::MAX_BYTES] = {0};
+    int padding = 8*((width+7)/8) - width;
+    for (int i=0; i<width; i++) {
+        if (frame[offset + i] == '1') {
+            data[(padding + i) / 8] |= 0x80 >> ((padding + i) % 8);
+        }
+    }
+    return formatPayload(data, width);
+}
+
+/**
+ * Sends `frame`, and every copy of it with a single bit flipped, which must all fail verification
+ */
+static void checkFrame(const std::string& frame, const std::string& expected) {
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin();
+    connectReader(wiegand);
+
+    sendFrame(wiegand, frame.c_str());
+    finishFrame(wiegand);
+    CHECK_EQUAL(expected, recorder.last());
+
+    for (size_t i=0; i<frame.size(); i++) {
+        std::string bad = frame;
+        bad[i] = bad[i] == '1' ? '0' : '1';
+        sendFrame(wiegand, bad.c_str());
+        finishFrame(wiegand);
+        CHECK_EQUAL(std::string("4!"), recorder.last().substr(0, 2));
+    }
+}
+
+static bool h10301Left(int i) { return i <= 12; }
+static bool h10301Right(int i) { return i >= 13; }
+
+TEST(format_h10301) {
+    const ParitySpec parity[] = {{0, false, h10301Left}, {25, true, h10301Right}};
+    std::string frame = encode(26, 1, 8, 123, 9, 16, 45678, parity, 2);
+    checkFrame(frame, payloadOf(frame, 1, 24));
+    CHECK_EQUAL(std::string("24:7bb26e"), payloadOf(frame, 1, 24));
+}
+
+static bool h10306Left(int i) { return i <= 16; }
+static bool h10306Right(int i) { return i >= 17; }
+
+TEST(format_h10306) {
+    const ParitySpec parity[] = {{0, false, h10306Left}, {33, true, h10306Right}};
+    std::string frame = encode(34, 1, 16, 0xBEEF, 17, 16, 0xCAFE, parity, 2);
+    checkFrame(frame, "32:beefcafe");
+}
+
+static bool h1030xLeft(int i) { return i <= 18; }
+static bool h1030xRight(int i) { return i >= 18; }
+
+TEST(format_h10304) {
+    const ParitySpec parity[] = {{0, false, h1030xLeft}, {36, true, h1030xRight}};
+    std::string frame = encode(37, 1, 16, 4321, 17, 19, 0x7FFFF, parity, 2);
+    checkFrame(frame, payloadOf(frame, 1, 35));
+}
+
+TEST(format_h10302) {
+    const ParitySpec parity[] = {{0, false, h1030xLeft}, {36, true, h1030xRight}};
+    std::string frame = encode(37, 0, 0, 0, 1, 35, 0x412345678ULL, parity, 2);
+    checkFrame(frame, "35:0412345678");
+}
+
+static bool c15001Left(int i) { return i <= 17; }
+static bool c15001Right(int i) { return i >= 18; }
+
+TEST(format_c15001) {
+    const ParitySpec parity[] = {{0, false, c15001Left}, {35, true, c15001Right}};
+    std::string frame = encode(36, 11, 8, 200, 19, 16, 60000, parity, 2);
+    checkFrame(frame, payloadOf(frame, 1, 34));
+}
+
+// Corporate 1000: Bit 1 covers bits 2,3,5,6..., the last bit covers bits 1,2,4,5..., the first bit covers everything
+static bool c1000Even(int i) { return i >= 2 && i % 3 != 1; }
+static bool c1000All(int) { return true; }
+
+static bool c1000OddOf35(int i) { return i >= 1 && i <= 33 && i % 3 != 0; }
+
+TEST(format_corporate1000_35) {
+    const ParitySpec parity[] = {{1, false, c1000Even}, {34, true, c1000OddOf35}, {0, true, c1000All}};
+    std::string frame = encode(35, 2, 12, 0xABC, 14, 20, 0x12345, parity, 3);
+    checkFrame(frame, "32:abc12345");
+}
+
+static bool c1000OddOf48(int i) { return i >= 1 && i <= 46 && i % 3 != 0; }
+static bool c1000EvenOf48(int i) { return c1000Even(i) && i <= 46; }
+
+TEST(format_corporate1000_48) {
+    const ParitySpec parity[] = {{1, false, c1000EvenOf48}, {47, true, c1000OddOf48}, {0, true, c1000All}};
+    std::string frame = encode(48, 2, 22, 0x2ABCDE, 24, 23, 0x654321, parity, 3);
+    checkFrame(frame, payloadOf(frame, 2, 45));
+}
+
+TEST(format_unknown_size) {
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin();
+    connectReader(wiegand);
+
+    sendFrame(wiegand, "000000000000000000000000000000");
+    finishFrame(wiegand);
+    CHECK_EQUAL(std::string("3!30:00000000"), recorder.last());
+}
+
+TEST(format_custom) {
+    typedef WiegandFormat F;
+    // A 34-bit reader with both parity bits inverted
+    static const WiegandFormat inverted = {
+        F::Custom, 34,
+        {{F::range(34, 0, 16), true}, {F::range(34, 17, 33), false}, {0, false}},
+        1, 32,  1, 16,  17, 16
+    };
+    // A 30-bit format with a single odd parity bit at the end
+    static const WiegandFormat custom30 = {
+        F::Custom + 1, 30,
+        {{F::range(30, 0, 29), true}, {0, false}, {0, false}},
+        0, 29,  0, 13,  13, 16
+    };
+    CHECK(WiegandFormats::add(inverted));
+    CHECK(WiegandFormats::add(custom30));
+
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin();
+    connectReader(wiegand);
+
+    sendFrame(wiegand, "0110111101010110110111110111011111");
+    finishFrame(wiegand);
+    CHECK_EQUAL(std::string("32:deadbeef"), recorder.last());
+
+    sendFrame(wiegand, "000000000000000000000000000001");
+    finishFrame(wiegand);
+    CHECK_EQUAL(std::string("29:00000000"), recorder.last());
+
+    WiegandFormats::clear();
+    sendFrame(wiegand, "0110111101010110110111110111011111");
+    finishFrame(wiegand);
+    CHECK_EQUAL(std::string("4!"), recorder.last().substr(0, 2));
+}
+
+TEST(format_custom_limit) {
+    static const WiegandFormat dummy = {WiegandFormat::Custom, 40, {{0, false}, {0, false}, {0, false}}, 0, 40, 0, 0, 0, 40};
+    for (int i=0; i<WIEGAND_MAX_CUSTOM_FORMATS; i++) {
+        CHECK(WiegandFormats::add(dummy));
+    }
+    CHECK(!WiegandFormats::add(dummy));
+    WiegandFormats::clear();
+
+    //No message is longer than 64 bits
+    static const WiegandFormat huge = {WiegandFormat::Custom, 65, {{0, false}, {0, false}, {0, false}}, 0, 64, 0, 0, 0, 64};
+    CHECK(!WiegandFormats::add(huge));
+    CHECK(WiegandFormats::add(dummy));
+    WiegandFormats::clear();
+}
+
+static uint64_t messageOf(const std::string& frame) {
+    uint64_t value = 0;
+    for (char c : frame) {
+        value = (value << 1) | (c == '1');
+    }
+    return value;
+}
+
+TEST(format_detect) {
+    const ParitySpec h10304[] = {{0, false, h1030xLeft}, {36, true, h1030xRight}};
+    const ParitySpec c1000_35[] = {{1, false, c1000Even}, {34, true, c1000OddOf35}, {0, true, c1000All}};
+    const ParitySpec c1000_48[] = {{1, false, c1000EvenOf48}, {47, true, c1000OddOf48}, {0, true, c1000All}};
+    const ParitySpec c15001[] = {{0, false, c15001Left}, {35, true, c15001Right}};
+    WiegandCredential credential;
+
+    std::string frame = encode(37, 1, 16, 4321, 17, 19, 0x7FFFF, h10304, 2);
+    CHECK(WiegandFormats::detect(37, messageOf(frame), credential));
+    CHECK_EQUAL(WiegandFormat::H10304, credential.format);
+    CHECK_EQUAL(4321u, credential.facility);
+    CHECK_EQUAL(0x7FFFFu, credential.card);
+
+    frame = encode(35, 2, 12, 0xABC, 14, 20, 0x12345, c1000_35, 3);
+    CHECK(WiegandFormats::detect(35, messageOf(frame), credential));
+    CHECK_EQUAL(WiegandFormat::Corporate1000_35, credential.format);
+    CHECK_EQUAL(0xABCu, credential.facility);
+    CHECK_EQUAL(0x12345u, credential.card);
+
+    frame = encode(48, 2, 22, 0x2ABCDE, 24, 23, 0x654321, c1000_48, 3);
+    CHECK(WiegandFormats::detect(48, messageOf(frame), credential));
+    CHECK_EQUAL(WiegandFormat::Corporate1000_48, credential.format);
+    CHECK_EQUAL(0x2ABCDEu, credential.facility);
+    CHECK_EQUAL(0x654321u, credential.card);
+
+    frame = encode(36, 11, 8, 200, 19, 16, 60000, c15001, 2);
+    CHECK(WiegandFormats::detect(36, messageOf(frame), credential));
+    CHECK_EQUAL(WiegandFormat::C15001, credential.format);
+    CHECK_EQUAL(200u, credential.facility);
+    CHECK_EQUAL(60000u, credential.card);
+
+    frame[5] = frame[5] == '1' ? '0' : '1';
+    CHECK(!WiegandFormats::detect(36, messageOf(frame), credential));
+    CHECK(!WiegandFormats::detect(30, 0, credential));
+    CHECK_EQUAL(std::string("Corporate 1000 (35-bit)"), std::string(WiegandFormats::name(WiegandFormat::Corporate1000_35)));
+}
+
+TEST(format_detect_priority) {
+    typedef WiegandFormat F;
+    // Same size as H10301, with a single even parity bit
+    static const WiegandFormat even26 = {
+        F::Custom, 26,
+        {{F::range(26, 0, 25), false}, {0, false}, {0, false}},
+        0, 25,  0, 0,  0, 25
+    };
+    const ParitySpec h10304[] = {{0, false, h1030xLeft}, {36, true, h1030xRight}};
+    const ParitySpec h10301[] = {{0, false, h10301Left}, {25, true, h10301Right}};
+    std::string frame37 = encode(37, 1, 16, 1, 17, 19, 2, h10304, 2);
+    WiegandCredential credential;
+
+    // H10302 can't be told apart from H10304, so it is only tried once registered, and then it always wins
+    CHECK(WiegandFormats::detect(37, messageOf(frame37), credential));
+    CHECK_EQUAL(WiegandFormat::H10304, credential.format);
+    CHECK_EQUAL(1u, credential.facility);
+    CHECK_EQUAL(2u, credential.card);
+
+    CHECK(WiegandFormats::add(WiegandFormats::H10302));
+    CHECK(WiegandFormats::add(even26));
+    CHECK(WiegandFormats::detect(37, messageOf(frame37), credential));
+    CHECK_EQUAL(WiegandFormat::H10302, credential.format);
+    CHECK_EQUAL(0u, credential.facility);
+    CHECK_EQUAL((uint64_t(1) << 19) | 2, credential.card);
+
+    // Both 26-bit formats are tried: H10301 messages always have odd parity as a whole, so they fall back to H10301
+    std::string frame26 = encode(26, 1, 8, 1, 9, 16, 2, h10301, 2);
+    CHECK(WiegandFormats::detect(26, messageOf(frame26), credential));
+    CHECK_EQUAL(WiegandFormat::H10301, credential.format);
+    // And this one doesn't pass H10301, but passes the custom one
+    frame26 = "00000000000000000000000000";
+    CHECK(WiegandFormats::detect(26, messageOf(frame26), credential));
+    CHECK_EQUAL(WiegandFormat::Custom, credential.format);
+
+    WiegandFormats::clear();
+}
+
+TEST(format_detect_raw) {
+    const ParitySpec c1000_35[] = {{1, false, c1000Even}, {34, true, c1000OddOf35}, {0, true, c1000All}};
+    struct Capture {
+        WiegandCredential credential;
+        bool detected;
+        static void onData(uint8_t* data, uint8_t bits, Capture* self) {
+            self->detected = WiegandFormats::detect(data, bits, self->credential);
+        }
+    } capture = Capture();
+
+    Wiegand wiegand = Wiegand();
+    wiegand.onReceive(Capture::onData, &capture);
+    wiegand.begin(Wiegand::LENGTH_ANY, false);
+    connectReader(wiegand);
+
+    sendFrame(wiegand, encode(35, 2, 12, 1000, 14, 20, 654321, c1000_35, 3).c_str());
+    finishFrame(wiegand);
+    CHECK(capture.detected);
+    CHECK_EQUAL(WiegandFormat::Corporate1000_35, capture.credential.format);
+    CHECK_EQUAL(1000u, capture.credential.facility);
+    CHECK_EQUAL(654321u, capture.credential.card);
+}
+
+struct CredentialRecorder {
+    std::vector<std::string> events;
+
+    static std::string format(const WiegandCredential& credential) {
+        return std::string(WiegandFormats::name(credential.format)) + " " +
+               std::to_string(credential.facility) + "/" + std::to_string(credential.card);
+    }
+
+    static void onCredential(const WiegandCredential& credential, CredentialRecorder* self) {
+        self->events.push_back(format(credential));
+    }
+
+    static void onChannelCredential(uint8_t channel, const WiegandCredential& credential, CredentialRecorder* self) {
+        self->events.push_back(std::to_string(channel) + ":" + format(credential));
+    }
+
+    std::string last() const {
+        return events.empty() ? std::string() : events.back();
+    }
+};
+
+TEST(credential_callback) {
+    const ParitySpec h10301[] = {{0, false, h10301Left}, {25, true, h10301Right}};
+    const ParitySpec c1000_35[] = {{1, false, c1000Even}, {34, true, c1000OddOf35}, {0, true, c1000All}};
+    std::string card26 = encode(26, 1, 8, 123, 9, 16, 45678, h10301, 2);
+    std::string card35 = encode(35, 2, 12, 4000, 14, 20, 1000000, c1000_35, 3);
+
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    CredentialRecorder credentials;
+    recorder.attach(wiegand);
+    wiegand.onCredential(CredentialRecorder::onCredential, &credentials);
+    wiegand.begin();
+    connectReader(wiegand);
+
+    sendFrame(wiegand, card26.c_str());
+    finishFrame(wiegand);
+    CHECK_EQUAL(std::string("24:7bb26e"), recorder.last());
+    sendFrame(wiegand, card35.c_str());
+    finishFrame(wiegand);
+    //Keypad messages and errors are not cards
+    sendFrame(wiegand, "1001");
+    finishFrame(wiegand);
+    card26[3] = card26[3] == '1' ? '0' : '1';
+    sendFrame(wiegand, card26.c_str());
+    finishFrame(wiegand);
+    CHECK_EQUAL(std::string("4!"), recorder.last().substr(0, 2));
+
+    CHECK_EQUAL(size_t(2), credentials.events.size());
+    CHECK_EQUAL(std::string("H10301 123/45678"), credentials.events[0]);
+    CHECK_EQUAL(std::string("Corporate 1000 (35-bit) 4000/1000000"), credentials.events[1]);
+
+    //Raw messages are not decoded
+    wiegand.begin(Wiegand::LENGTH_ANY, false);
+    connectReader(wiegand);
+    sendFrame(wiegand, card35.c_str());
+    finishFrame(wiegand);
+    CHECK_EQUAL(size_t(2), credentials.events.size());
+}
+
+TEST(credential_callback_static_and_bank) {
+    const ParitySpec h10306[] = {{0, false, h10306Left}, {33, true, h10306Right}};
+    std::string card34 = encode(34, 1, 16, 0xBEEF, 17, 16, 0xCAFE, h10306, 2);
+    CredentialRecorder credentials;
+
+    StaticWiegand<34> fixed;
+    fixed.onCredential(CredentialRecorder::onCredential, &credentials);
+    fixed.begin();
+    connectReader(fixed);
+    sendFrame(fixed, card34.c_str());
+    CHECK_EQUAL(size_t(1), credentials.events.size());
+    CHECK_EQUAL(std::string("H10306 48879/51966"), credentials.last());
+
+    WiegandBank<2> bank;
+    bank.onCredential(CredentialRecorder::onChannelCredential, &credentials);
+    bank.begin(34);
+    bank.setPinState(1, 0, true);
+    bank.setPinState(1, 1, true);
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    bank.flush();
+    for (char c : card34) {
+        bank.setPinState(1, c == '1', false);
+        HostClock::advance(50);
+        bank.setPinState(1, c == '1', true);
+        HostClock::advance(1950);
+    }
+    CHECK_EQUAL(size_t(2), credentials.events.size());
+    CHECK_EQUAL(std::string("1:H10306 48879/51966"), credentials.last());
+}
+
+TEST(credential_static_fixed_format) {
+    typedef WiegandFormat F;
+    // Same size as H10301, with a single even parity bit
+    static const WiegandFormat even26 = {
+        F::Custom, 26,
+        {{F::range(26, 0, 25), false}, {0, false}, {0, false}},
+        0, 25,  0, 0,  0, 25
+    };
+    const ParitySpec h1030x[] = {{0, false, h1030xLeft}, {36, true, h1030xRight}};
+    const ParitySpec h10301[] = {{0, false, h10301Left}, {25, true, h10301Right}};
+    std::string card37 = encode(37, 0, 0, 0, 1, 35, 0x412345678ULL, h1030x, 2);
+    std::string card26 = encode(26, 1, 8, 12, 9, 16, 3456, h10301, 2);
+    CHECK(WiegandFormats::add(even26));
+
+    //H10302 is decoded without being registered, and other sizes still go through the registry
+    typedef StaticWiegand<Wiegand::LENGTH_ANY, true, Wiegand::MAX_BITS, uint8_t, &WiegandFormats::H10302> AnySize;
+    AnySize any;
+    CredentialRecorder credentials;
+    any.onCredential(CredentialRecorder::onCredential, &credentials);
+    any.begin();
+    connectReader(any);
+    sendFrame(any, card37.c_str());
+    finishFrame(any);
+    CHECK_EQUAL(std::string("H10302 0/17485289080"), credentials.last());
+    sendFrame(any, card26.c_str());
+    finishFrame(any);
+    CHECK_EQUAL(std::string("H10301 12/3456"), credentials.last());
+
+    //The fixed format is the only one tried for its size: The registered 26-bit format is ignored
+    typedef StaticWiegand<26, true, Wiegand::MAX_BITS, uint8_t, &WiegandFormats::H10301> Fixed26;
+    Fixed26 fixed;
+    Recorder recorder;
+    recorder.attach(fixed);
+    fixed.onCredential(CredentialRecorder::onCredential, &credentials);
+    fixed.begin();
+    connectReader(fixed);
+    sendFrame(fixed, "00000000000000000000000000");
+    CHECK_EQUAL(std::string("4!26:00000000"), recorder.last());
+    sendFrame(fixed, card26.c_str());
+    CHECK_EQUAL(std::string("24:0c0d80"), recorder.last());
+    CHECK_EQUAL(size_t(3), credentials.events.size());
+
+    WiegandFormats::clear();
+}
@@ -0,0 +1,75 @@
+#include "harness.h"
+#include "recorder.h"
+#include <WiegandFrameQueue.h>
+
+TEST(frame_queue) {
+    Wiegand wiegand = Wiegand();
+    WiegandFrameQueue<2> queue;
+    queue.attach(wiegand);
+    wiegand.begin(4);
+    connectReader(wiegand);
+    CHECK(queue.empty());
+    CHECK(queue.peek() == nullptr);
+
+    sendFrame(wiegand, "1001");
+    unsigned long first_timestamp = millis();
+    sendFrame(wiegand, "10");
+    finishFrame(wiegand);
+    CHECK_EQUAL(2, queue.size());
+    CHECK_EQUAL(0, queue.dropped());
+
+    //Queue is full, this one is lost
+    sendFrame(wiegand, "0011");
+    CHECK_EQUAL(2, queue.size());
+    CHECK_EQUAL(1, queue.dropped());
+
+    WiegandFrame frame;
+    CHECK(queue.tryPop(frame));
+    CHECK_EQUAL(std::string("4:09"), formatPayload(frame.data, frame.bits));
+    CHECK(frame.valid);
+    CHECK(frame.timestamp <= first_timestamp);
+    CHECK(frame.timestamp + 2 >= first_timestamp);
+
+    const WiegandFrame* error = queue.peek();
+    CHECK(error != nullptr);
+    CHECK(!error->valid);
+    CHECK_EQUAL(Wiegand::SizeUnexpected, error->error);
+    CHECK_EQUAL(std::string("2:02"), formatPayload(error->data, error->bits));
+    queue.pop();
+    CHECK(queue.empty());
+    CHECK(!queue.tryPop(frame));
+}
+
+TEST(credential_queue) {
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    WiegandCredentialQueue<2> queue;
+    recorder.attach(wiegand);
+    queue.attach(wiegand);
+    wiegand.begin(26);
+    connectReader(wiegand);
+    CHECK(queue.empty());
+    CHECK(queue.peek() == nullptr);
+
+    //Facility 1, card 2; then facility 3, card 4
+    sendFrame(wiegand, "10000000100000000000000100");
+    sendFrame(wiegand, "00000001100000000000001000");
+    //Queue is full, this one is lost
+    sendFrame(wiegand, "10000000100000000000000100");
+    CHECK_EQUAL(2, queue.size());
+    CHECK_EQUAL(1, queue.dropped());
+    //Data callbacks are still called
+    CHECK_EQUAL(size_t(4), recorder.events.size());
+
+    WiegandCredential credential;
+    CHECK(queue.tryPop(credential));
+    CHECK_EQUAL(WiegandFormat::H10301, credential.format);
+    CHECK_EQUAL(1u, credential.facility);
+    CHECK_EQUAL(2u, credential.card);
+
+    const WiegandCredential* next = queue.peek();
+    CHECK(next != nullptr && next->facility == 3 && next->card == 4);
+    queue.pop();
+    CHECK(queue.empty());
+    CHECK(!queue.tryPop(credential));
+}
@@ -0,0 +1,114 @@
+#include "harness.h"
+#include "recorder.h"
+#include <InlineWiegand.h>
+
+/**
+ * Records all events, in the same format as `Recorder`
+ */
+class RecordingReader : public InlineWiegand<RecordingReader> {
+public:
+    std::vector<std::string> events;
+    std::vector<std::string> credentials;
+
+    void onReceive(uint8_t* data, uint8_t bits) {
+        events.push_back(formatPayload(data, bits));
+    }
+
+    void onReceiveError(Wiegand::DataError error, uint8_t* data, uint8_t bits) {
+        events.push_back(std::to_string(int(error)) + "!" + formatPayload(data, bits));
+    }
+
+    void onStateChange(bool plugged) {
+        events.push_back(plugged ? "+" : "-");
+    }
+
+    void onCredential(const WiegandCredential& credential) {
+        credentials.push_back(std::to_string(credential.facility) + "/" + std::to_string(credential.card));
+    }
+};
+
+/**
+ * Only cares about messages
+ */
+class DataOnlyReader : public InlineWiegand<DataOnlyReader, 26> {
+public:
+    std::string last;
+
+    void onReceive(uint8_t* data, uint8_t bits) {
+        last = formatPayload(data, bits);
+    }
+};
+
+/**
+ * Feeds the same random messages (of common sizes, with random content and sometimes
+ * random interruptions) to an `InlineWiegand` and to a `Wiegand` with the same configuration
+ */
+static void checkInlineMatchesWiegand(uint8_t expected_bits, bool decode_messages, uint32_t seed) {
+    static const uint8_t sizes[] = {4, 8, 26, 34, 37, 70};
+
+    RecordingReader reader;
+    reader.begin(expected_bits, decode_messages);
+
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin(expected_bits, decode_messages);
+
+    for (int message=0; message<2000; message++) {
+        seed = seed * 1103515245 + 12345;
+        uint8_t bits = sizes[(seed >> 16) % 6];
+        for (uint8_t i=0; i<bits; i++) {
+            seed = seed * 1103515245 + 12345;
+            uint8_t pin = (seed >> 16) & 1;
+            //Now and then, a pin goes low without returning, or a message is cut short
+            bool glitch = ((seed >> 20) & 255) == 0;
+            reader.setPinState(pin, false);
+            wiegand.setPinState(pin, false);
+            if (!glitch) {
+                reader.setPinState(pin, true);
+                wiegand.setPinState(pin, true);
+            }
+            HostClock::advance(((seed >> 24) & 63) == 0 ? 30000 : 2000);
+        }
+        reader.setPinState(0, true);
+        reader.setPinState(1, true);
+        wiegand.setPinState(0, true);
+        wiegand.setPinState(1, true);
+        HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+        reader.flush();
+        wiegand.flush();
+    }
+
+    CHECK(recorder.events.size() > 100);
+    CHECK(recorder.events == reader.events);
+}
+
+TEST(inline_matches_wiegand) {
+    checkInlineMatchesWiegand(Wiegand::LENGTH_ANY, true, 1);
+    checkInlineMatchesWiegand(Wiegand::LENGTH_ANY, false, 2);
+    checkInlineMatchesWiegand(26, true, 3);
+    checkInlineMatchesWiegand(34, false, 4);
+    checkInlineMatchesWiegand(8, true, 5);
+}
+
+TEST(inline_handlers) {
+    RecordingReader reader;
+    reader.begin(26);
+    connectReader(reader);
+    CHECK(reader);
+
+    //H10301: Facility 1, card 2
+    sendFrame(reader, "10000000100000000000000100");
+    CHECK_EQUAL(std::string("24:010002"), reader.events.back());
+    CHECK_EQUAL(size_t(1), reader.credentials.size());
+    CHECK_EQUAL(std::string("1/2"), reader.credentials.back());
+
+    DataOnlyReader data_only;
+    data_only.begin(26);
+    connectReader(data_only);
+    sendFrame(data_only, "10000000100000000000000100");
+    CHECK_EQUAL(std::string("24:010002"), data_only.last);
+
+    //No pointers are kept
+    CHECK(sizeof(RecordingReader) - sizeof(reader.events) - sizeof(reader.credentials) < sizeof(Wiegand));
+}
@@ -0,0 +1,221 @@
+#include "harness.h"
+#include "recorder.h"
+#include <StaticWiegand.h>
+#include <WiegandBank.h>
+
+/**
+ * A pin change, as seen by the interruption handler
+ */
+struct PinEdge {
+    unsigned long time;     // Microseconds
+    uint8_t pin;
+    bool level;
+};
+
+/**
+ * Builds the pin changes of a reader being plugged at `start`, and sending `frames` cards every `interval` microseconds
+ */
+static std::vector<PinEdge> cardReads(unsigned long start, int frames, unsigned long interval) {
+    static const char* cards[] = {"10000000100000000000000100", "00000001100000000000001000"};
+    std::vector<PinEdge> edges;
+    edges.push_back({start, 0, true});
+    edges.push_back({start, 1, true});
+    for (int frame=0; frame<frames; frame++) {
+        unsigned long time = start + (frame + 1) * interval;
+        for (const char* c = cards[frame % 2]; *c; c++) {
+            edges.push_back({time, uint8_t(*c == '1'), false});
+            edges.push_back({time + 50, uint8_t(*c == '1'), true});
+            time += 2000;
+        }
+    }
+    return edges;
+}
+
+/**
+ * Simulates a main loop sleeping between pin changes, until `end` microseconds.
+ *
+ * With `tickless`, it sleeps until the next pin change or the decoder's deadline, whatever comes first.
+ * Otherwise, it wakes up every 100ms to call `flush()`, like the examples.
+ *
+ * Returns how many times the main loop was woken up by its timer. Pin changes wake it up too, but only to run the interruption handler.
+ */
+template<typename Decoder>
+static unsigned long runSleepyLoop(Decoder& wiegand, const std::vector<PinEdge>& edges, unsigned long end, bool tickless) {
+    unsigned long wakeups = 0;
+    unsigned long next_tick = micros() + 100000;
+    size_t next_edge = 0;
+    while (true) {
+        unsigned long wake_at;
+        unsigned long deadline;
+        if (!tickless) {
+            wake_at = next_tick;
+        } else if (wiegand.nextDeadline(deadline)) {
+            wake_at = deadline * 1000UL;
+        } else {
+            //Deep sleep, only a pin change wakes it up
+            wake_at = end;
+        }
+
+        if (next_edge < edges.size() && long(edges[next_edge].time - wake_at) < 0) {
+            HostClock::set(edges[next_edge].time);
+            wiegand.setPinState(edges[next_edge].pin, edges[next_edge].level);
+            next_edge++;
+            continue;
+        }
+        if (long(wake_at - end) >= 0) {
+            HostClock::set(end);
+            return wakeups;
+        }
+        HostClock::set(wake_at);
+        wakeups++;
+        wiegand.flush();
+        next_tick += 100000;
+    }
+}
+
+TEST(low_power_wakeups) {
+    HostClock::set(0);
+    std::vector<PinEdge> edges = cardReads(1000000, 5, 2000000);
+    unsigned long end = 13050000;
+
+    Wiegand polled = Wiegand(), tickless = Wiegand();
+    Recorder polled_recorder, tickless_recorder;
+    polled_recorder.attach(polled);
+    tickless_recorder.attach(tickless);
+    polled.begin();
+    tickless.begin();
+
+    //Polling: 10 wakeups per second, for 13 seconds
+    CHECK_EQUAL(130ul, runSleepyLoop(polled, edges, end, false));
+    HostClock::set(0);
+    //Tickless: A single wakeup per card, right when it ends
+    CHECK_EQUAL(5ul, runSleepyLoop(tickless, edges, end, true));
+
+    CHECK_EQUAL(6u, tickless_recorder.events.size());
+    CHECK(polled_recorder.events == tickless_recorder.events);
+    CHECK(tickless_recorder.events.size() > 2 && tickless_recorder.events[2] == "24:030004");
+
+    //Idle, with a reader connected: No wakeups at all
+    unsigned long deadline;
+    CHECK(!tickless.nextDeadline(deadline));
+    HostClock::set(20000000);
+    CHECK_EQUAL(0ul, runSleepyLoop(tickless, std::vector<PinEdge>(), 60000000, true));
+}
+
+TEST(low_power_deadline_is_exact) {
+    HostClock::set(0);
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin(Wiegand::LENGTH_ANY, false);
+    connectReader(wiegand);
+
+    sendFrame(wiegand, "1010");
+    unsigned long deadline;
+    CHECK(wiegand.nextDeadline(deadline));
+
+    //A moment before the deadline, nothing happens
+    HostClock::set(deadline * 1000UL - 1000);
+    wiegand.flush();
+    CHECK_EQUAL(std::string("+"), recorder.last());
+    HostClock::set(deadline * 1000UL);
+    wiegand.flush();
+    CHECK_EQUAL(std::string("4:0a"), recorder.last());
+    CHECK(!wiegand.nextDeadline(deadline));
+}
+
+TEST(low_power_other_decoders) {
+    HostClock::set(0);
+    std::vector<PinEdge> edges = cardReads(1000000, 3, 1000000);
+
+    StaticWiegand<> fixed;
+    Recorder recorder;
+    recorder.attach(fixed);
+    fixed.begin();
+    CHECK_EQUAL(3ul, runSleepyLoop(fixed, edges, 5000000, true));
+    CHECK_EQUAL(4u, recorder.events.size());
+
+    //A bank wakes up for the earliest of its channels
+    WiegandBank<2> bank;
+    bank.begin(Wiegand::LENGTH_ANY, false);
+    unsigned long deadline;
+    CHECK(!bank.nextDeadline(deadline));
+    for (uint8_t channel=0; channel<2; channel++) {
+        bank.setPinState(channel, 0, true);
+        bank.setPinState(channel, 1, true);
+    }
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    bank.flush();
+    bank.setPinState(1, 0, false);
+    bank.setPinState(1, 0, true);
+    unsigned long first = millis();
+    HostClock::advanceMillis(5);
+    bank.setPinState(0, 1, false);
+    bank.setPinState(0, 1, true);
+    CHECK(bank.nextDeadline(deadline));
+    CHECK_EQUAL(first + Wiegand::TIMEOUT + 1, deadline);
+}
+
+/**
+ * Records the messages of a bank as "<channel>/<bits>:<hex>"
+ */
+static void onBankData(uint8_t channel, uint8_t* data, uint8_t bits, Recorder* recorder) {
+    recorder->events.push_back(std::to_string(channel) + "/" + formatPayload(data, bits));
+}
+
+/**
+ * Connects a reader and sends a card `idle` milliseconds later, without calling `flush()` in between, as a tickless loop does
+ */
+template<typename Decoder> static void settleWithoutFlush(Decoder& wiegand, unsigned long idle) {
+    wiegand.setPin0State(true);
+    wiegand.setPin1State(true);
+    unsigned long deadline;
+    CHECK(!wiegand.nextDeadline(deadline));
+    HostClock::advanceMillis(idle);
+    sendFrame(wiegand, "10000000100000000000000100");
+    CHECK(wiegand.nextDeadline(deadline));
+    HostClock::set(deadline * 1000UL);
+    wiegand.flush();
+}
+
+TEST(low_power_settle_without_flush) {
+    //The settle time doesn't need a wakeup: The first pin change after it ends it
+    for (unsigned long idle : {Wiegand::TIMEOUT + 1UL, 40000UL}) {
+        Wiegand wiegand = Wiegand();
+        Recorder recorder;
+        recorder.attach(wiegand);
+        wiegand.begin();
+        settleWithoutFlush(wiegand, idle);
+        CHECK_EQUAL(std::string("24:010002"), recorder.last());
+
+        StaticWiegand<> fixed;
+        Recorder fixed_recorder;
+        fixed_recorder.attach(fixed);
+        fixed.begin();
+        settleWithoutFlush(fixed, idle);
+        CHECK_EQUAL(std::string("24:010002"), fixed_recorder.last());
+    }
+
+    //Same on a bank, for each channel on its own
+    WiegandBank<2> bank;
+    Recorder recorder;
+    bank.onReceive(onBankData, &recorder);
+    bank.begin(Wiegand::LENGTH_ANY, false);
+    for (uint8_t channel=0; channel<2; channel++) {
+        bank.setPinState(channel, 0, true);
+        bank.setPinState(channel, 1, true);
+    }
+    unsigned long deadline;
+    CHECK(!bank.nextDeadline(deadline));
+    HostClock::advanceMillis(40000);
+    for (const char* c = "1010"; *c; c++) {
+        bank.setPinState(1, *c == '1', false);
+        HostClock::advance(50);
+        bank.setPinState(1, *c == '1', true);
+        HostClock::advance(1950);
+    }
+    CHECK(bank.nextDeadline(deadline));
+    HostClock::set(deadline * 1000UL);
+    bank.flush();
+    CHECK_EQUAL(std::string("1/4:0a"), recorder.last());
+}
@@ -0,0 +1,107 @@
+#include "harness.h"
+#include "recorder.h"
+#include <WiegandPort.h>
+
+/**
+ * Collects callbacks from all channels of a port, using the same format as `Recorder`
+ */
+struct PortRecorder {
+    std::vector<std::string> events[4];
+
+    static void onData(uint8_t channel, uint8_t* data, uint8_t bits, PortRecorder* self) {
+        self->events[channel].push_back(formatPayload(data, bits));
+    }
+
+    static void onError(uint8_t channel, Wiegand::DataError error, uint8_t* data, uint8_t bits, PortRecorder* self) {
+        self->events[channel].push_back(std::to_string(int(error)) + "!" + formatPayload(data, bits));
+    }
+
+    static void onState(uint8_t channel, bool plugged, PortRecorder* self) {
+        self->events[channel].push_back(plugged ? "+" : "-");
+    }
+};
+
+template<uint8_t N>
+static void checkPortMatchesWiegand(uint8_t expected_bits, uint32_t seed) {
+    WiegandPort<N> port;
+    PortRecorder port_recorder;
+    port.onReceive(PortRecorder::onData, &port_recorder);
+    port.onReceiveError(PortRecorder::onError, &port_recorder);
+    port.onStateChange(PortRecorder::onState, &port_recorder);
+    port.begin(expected_bits);
+
+    Wiegand wiegand[N];
+    Recorder recorder[N];
+    for (uint8_t channel=0; channel<N; channel++) {
+        wiegand[channel] = Wiegand();
+        recorder[channel].attach(wiegand[channel]);
+        wiegand[channel].begin(expected_bits);
+    }
+
+    uint8_t sample = 0;
+    for (int step=0; step<50000; step++) {
+        seed = seed * 1103515245 + 12345;
+        if (((seed >> 8) & 63) == 0) {
+            //Now and then, anything goes
+            sample = uint8_t(seed >> 16);
+        } else if (((seed >> 14) & 3) == 0) {
+            //Readers idle with both lines high
+            sample = 0xFF;
+        } else {
+            //Toggles a single pin
+            sample ^= uint8_t(1 << ((seed >> 16) % (2*N)));
+        }
+        HostClock::advance(((seed >> 20) & 0x7F) == 0 ? 40000 : (seed >> 20) % 3000);
+
+        port.setPortState(sample);
+        for (uint8_t channel=0; channel<N; channel++) {
+            wiegand[channel].setPin0State((sample >> (2*channel)) & 1);
+            wiegand[channel].setPin1State((sample >> (2*channel + 1)) & 1);
+        }
+        if (step % 128 == 0) {
+            port.flush();
+            for (uint8_t channel=0; channel<N; channel++) {
+                wiegand[channel].flush();
+            }
+        }
+    }
+
+    for (uint8_t channel=0; channel<N; channel++) {
+        CHECK(recorder[channel].events.size() > 10);
+        CHECK(recorder[channel].events == port_recorder.events[channel]);
+    }
+}
+
+TEST(port_matches_wiegand) {
+    checkPortMatchesWiegand<4>(Wiegand::LENGTH_ANY, 1);
+    checkPortMatchesWiegand<4>(4, 2);
+    checkPortMatchesWiegand<3>(Wiegand::LENGTH_ANY, 3);
+    checkPortMatchesWiegand<1>(8, 4);
+}
+
+TEST(port_over_255_bits) {
+    struct Capture {
+        std::vector<uint16_t> sizes;
+        static void onData(uint8_t channel, uint8_t* data, uint16_t bits, Capture* self) {
+            self->sizes.push_back(bits);
+        }
+    } capture;
+
+    //With a 16-bit counter, reaching 255 bits isn't reaching `LENGTH_ANY`
+    WiegandPort<1, 300, uint16_t> port;
+    port.onReceive(Capture::onData, &capture);
+    port.begin(Wiegand::LENGTH_ANY, false);
+    port.setPortState(0x03);
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    port.flush();
+
+    for (int i=0; i<280; i++) {
+        port.setPortState(i & 1 ? 0x01 : 0x02);
+        port.setPortState(0x03);
+        HostClock::advanceMillis(2);
+    }
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    port.flush();
+    CHECK_EQUAL(1u, capture.sizes.size());
+    CHECK_EQUAL(280, capture.sizes[0]);
+}
@@ -0,0 +1,241 @@
+#include "harness.h"
+#include "recorder.h"
+#include <WiegandScheduler.h>
+#include <WiegandTiming.h>
+
+TEST(scheduler_flushes_expired_readers) {
+    static const uint8_t READERS = 16;
+    Wiegand wiegand[READERS];
+    Recorder recorder[READERS];
+    WiegandScheduler<READERS> scheduler;
+    for (uint8_t i=0; i<READERS; i++) {
+        recorder[i].attach(wiegand[i]);
+        CHECK(scheduler.attach(wiegand[i]));
+        wiegand[i].begin(Wiegand::LENGTH_ANY, false);
+        connectReader(wiegand[i]);
+    }
+    Wiegand extra;
+    CHECK(!scheduler.attach(extra));
+
+    unsigned long deadline;
+    CHECK(!scheduler.nextDeadline(deadline));
+    CHECK_EQUAL(0, scheduler.pending());
+
+    //Two readers receive a message, 10ms apart
+    sendFrame(wiegand[3], "1010");
+    HostClock::advanceMillis(10);
+    sendFrame(wiegand[12], "0110");
+    CHECK_EQUAL(2, scheduler.pending());
+    CHECK(scheduler.nextDeadline(deadline));
+
+    //Nothing is due yet
+    scheduler.service();
+    CHECK_EQUAL(std::string("+"), recorder[3].last());
+    CHECK_EQUAL(2, scheduler.pending());
+
+    //Reader 3 is due first. Its deadline was pushed back by each bit, so it is checked again until then
+    while (recorder[3].last() == "+") {
+        CHECK(scheduler.nextDeadline(deadline));
+        HostClock::set(deadline * 1000UL);
+        scheduler.service();
+    }
+    CHECK_EQUAL(std::string("4:0a"), recorder[3].last());
+    CHECK(millis() - wiegand[3].lastEventTime() == Wiegand::TIMEOUT + 1u);
+    CHECK_EQUAL(std::string("+"), recorder[12].last());
+    CHECK_EQUAL(1, scheduler.pending());
+
+    HostClock::advanceMillis(20);
+    scheduler.service();
+    CHECK_EQUAL(std::string("4:06"), recorder[12].last());
+    CHECK_EQUAL(0, scheduler.pending());
+
+    //Nobody else was ever flushed
+    for (uint8_t i=0; i<READERS; i++) {
+        CHECK_EQUAL(size_t(i == 3 || i == 12 ? 2 : 1), recorder[i].events.size());
+    }
+}
+
+TEST(scheduler_expected_size_and_adaptive) {
+    Wiegand fixed, adaptive;
+    Recorder fixed_recorder, adaptive_recorder;
+    WiegandScheduler<2> scheduler;
+    fixed_recorder.attach(fixed);
+    adaptive_recorder.attach(adaptive);
+    scheduler.attach(fixed);
+    scheduler.attach(adaptive);
+    fixed.begin(4, false);
+    WiegandTiming timing;
+    timing.setAdaptiveTimeout(4);
+    adaptive.setTiming(&timing);
+    adaptive.begin(Wiegand::LENGTH_ANY, false);
+    connectReader(fixed);
+    connectReader(adaptive);
+
+    //Messages of a known size are already out when their deadline comes: The reader is just dropped
+    sendFrame(fixed, "1010");
+    CHECK_EQUAL(std::string("4:0a"), fixed_recorder.last());
+    CHECK_EQUAL(1, scheduler.pending());
+    sendFrame(fixed, "1010");
+    CHECK_EQUAL(1, scheduler.pending());
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    scheduler.service();
+    CHECK_EQUAL(0, scheduler.pending());
+    CHECK_EQUAL(3u, fixed_recorder.events.size());
+
+    //Deadlines that come closer (as the bit period is learned) are followed
+    unsigned long first_deadline, deadline;
+    sendFrame(adaptive, "1");
+    CHECK(scheduler.nextDeadline(first_deadline));
+    sendFrame(adaptive, "010");
+    CHECK(scheduler.nextDeadline(deadline));
+    CHECK(long(deadline - first_deadline) < 0);
+    unsigned long reader_deadline;
+    CHECK(adaptive.nextDeadline(reader_deadline));
+    CHECK(long(deadline - reader_deadline) <= 0);
+
+    HostClock::set(reader_deadline * 1000UL);
+    scheduler.service();
+    CHECK_EQUAL(std::string("4:0a"), adaptive_recorder.last());
+    CHECK_EQUAL(0, scheduler.pending());
+}
+
+TEST(scheduler_random_matches_flush) {
+    //Same random traffic on readers flushed on every step and on readers flushed by the scheduler
+    static const uint8_t READERS = 8;
+    Wiegand polled[READERS], scheduled[READERS];
+    Recorder polled_recorder[READERS], scheduled_recorder[READERS];
+    WiegandScheduler<READERS> scheduler;
+    for (uint8_t i=0; i<READERS; i++) {
+        polled_recorder[i].attach(polled[i]);
+        scheduled_recorder[i].attach(scheduled[i]);
+        scheduler.attach(scheduled[i]);
+        polled[i].begin(Wiegand::LENGTH_ANY, false);
+        scheduled[i].begin(Wiegand::LENGTH_ANY, false);
+    }
+
+    uint32_t seed = 7;
+    for (int step=0; step<50000; step++) {
+        seed = seed * 1103515245 + 12345;
+        uint8_t reader = (seed >> 16) % READERS;
+        uint8_t pin = (seed >> 20) & 1;
+        bool level = ((seed >> 21) & 3) != 0;
+        polled[reader].setPinState(pin, level);
+        scheduled[reader].setPinState(pin, level);
+        HostClock::advance(((seed >> 24) & 31) == 0 ? 30000 : 500);
+        for (uint8_t i=0; i<READERS; i++) {
+            polled[i].flush();
+        }
+        scheduler.service();
+    }
+
+    for (uint8_t i=0; i<READERS; i++) {
+        CHECK(polled_recorder[i].events.size() > 10);
+        CHECK(polled_recorder[i].events == scheduled_recorder[i].events);
+    }
+}
+
+/**
+ * Sends a frame from a fast reader: 50us pulses, 200us apart
+ */
+static void sendFastFrame(Wiegand& wiegand, const char* bits) {
+    for (const char* c = bits; *c; c++) {
+        wiegand.setPinState(*c == '1', false);
+        HostClock::advance(50);
+        wiegand.setPinState(*c == '1', true);
+        HostClock::advance(150);
+    }
+}
+
+TEST(scheduler_microsecond_readers) {
+    Wiegand fast[2], slow;
+    Recorder recorder[2];
+    WiegandTiming timing[2];
+    WiegandScheduler<3> scheduler;
+    for (uint8_t i=0; i<2; i++) {
+        timing[i].setTimeouts(600, 0, 1000, true);
+        fast[i].setTiming(&timing[i]);
+        recorder[i].attach(fast[i]);
+        CHECK(scheduler.attach(fast[i]));
+        fast[i].begin(Wiegand::LENGTH_ANY, false);
+        fast[i].setPin0State(true);
+        fast[i].setPin1State(true);
+    }
+    //Readers in milliseconds can't share it
+    CHECK(!scheduler.attach(slow));
+    HostClock::advance(1001);
+
+    //Deadlines are in microseconds, and so is the time `service()` reads
+    sendFastFrame(fast[0], "1010");
+    sendFastFrame(fast[1], "0110");
+    CHECK_EQUAL(2, scheduler.pending());
+    scheduler.service();
+    CHECK_EQUAL(std::string("4:0a"), recorder[0].last());
+    CHECK_EQUAL(std::string("+"), recorder[1].last());
+    CHECK_EQUAL(1, scheduler.pending());
+    HostClock::advance(500);
+    scheduler.service();
+    CHECK_EQUAL(std::string("4:06"), recorder[1].last());
+    CHECK_EQUAL(0, scheduler.pending());
+}
+
+TEST(scheduler_keeps_interruptions_disabled) {
+    Wiegand wiegand;
+    WiegandScheduler<1> scheduler;
+    scheduler.attach(wiegand);
+    wiegand.begin(Wiegand::LENGTH_ANY, false);
+    connectReader(wiegand);
+    sendFrame(wiegand, "1010");
+
+    //A main loop about to sleep keeps them disabled from the check until it sleeps
+    unsigned long deadline;
+    noInterrupts();
+    CHECK(scheduler.nextDeadline(deadline));
+    scheduler.service();
+    CHECK(!(SREG & 0x80));
+    interrupts();
+
+    //And they are enabled again if they were
+    scheduler.service();
+    CHECK(SREG & 0x80);
+}
+
+TEST(scheduler_large_heap) {
+    //Past 128 readers, children of heap positions don't fit in a byte
+    static const uint8_t READERS = 254;
+    static Wiegand wiegand[READERS];
+    static Recorder recorder[READERS];
+    WiegandScheduler<READERS> scheduler;
+    for (uint8_t i=0; i<READERS; i++) {
+        recorder[i].attach(wiegand[i]);
+        CHECK(scheduler.attach(wiegand[i]));
+        wiegand[i].begin(Wiegand::LENGTH_ANY, false);
+        connectReader(wiegand[i]);
+    }
+
+    //Every reader gets a bit, in an order that isn't the one they are due in
+    for (uint16_t i=0; i<READERS; i++) {
+        uint8_t reader = uint8_t((i * 97) % READERS);
+        wiegand[reader].setPinState(reader & 1, false);
+        wiegand[reader].setPinState(reader & 1, true);
+        HostClock::advance(100);
+    }
+    CHECK_EQUAL(READERS, scheduler.pending());
+
+    //They are flushed in the order of their deadlines
+    unsigned long previous = 0;
+    uint16_t flushed = 0;
+    unsigned long deadline;
+    while (scheduler.nextDeadline(deadline)) {
+        CHECK(flushed == 0 || long(deadline - previous) >= 0);
+        previous = deadline;
+        HostClock::set(deadline * 1000UL);
+        uint8_t pending = scheduler.pending();
+        scheduler.service();
+        CHECK(scheduler.pending() < pending);
+        flushed += pending - scheduler.pending();
+    }
+    CHECK_EQUAL(READERS, flushed);
+    for (uint8_t i=0; i<READERS; i++) {
+        CHECK_EQUAL(std::string(i & 1 ? "1:01" : "1:00"), recorder[i].last());
+    }
+}
@@ -0,0 +1,171 @@
+#include "harness.h"
+#include "recorder.h"
+#include <StaticWiegand.h>
+#include <new>
+
+/**
+ * Feeds the same random messages (of common sizes, with random content and sometimes
+ * random interruptions) to a `StaticWiegand` and to a `Wiegand` with the same configuration
+ */
+template<uint8_t EXPECTED_BITS, bool DECODE_MESSAGES, const WiegandFormat* FORMAT=nullptr>
+static void checkStaticMatchesWiegand(uint32_t seed) {
+    static const uint8_t sizes[] = {4, 8, 26, 34, 37};
+
+    typedef StaticWiegand<EXPECTED_BITS, DECODE_MESSAGES, Wiegand::MAX_BITS, uint8_t, FORMAT> Fixed;
+    Fixed fixed;
+    Recorder fixed_recorder;
+    fixed_recorder.attach(fixed);
+    fixed.begin();
+
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin(EXPECTED_BITS, DECODE_MESSAGES);
+
+    for (int message=0; message<2000; message++) {
+        seed = seed * 1103515245 + 12345;
+        uint8_t bits = sizes[(seed >> 16) % 5];
+        for (uint8_t i=0; i<bits; i++) {
+            seed = seed * 1103515245 + 12345;
+            uint8_t pin = (seed >> 16) & 1;
+            //Now and then, a pin goes low without returning, or a message is cut short
+            bool glitch = ((seed >> 20) & 255) == 0;
+            fixed.setPinState(pin, false);
+            wiegand.setPinState(pin, false);
+            if (!glitch) {
+                fixed.setPinState(pin, true);
+                wiegand.setPinState(pin, true);
+            }
+            HostClock::advance(((seed >> 24) & 63) == 0 ? 30000 : 2000);
+        }
+        fixed.setPinState(0, true);
+        fixed.setPinState(1, true);
+        wiegand.setPinState(0, true);
+        wiegand.setPinState(1, true);
+        HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+        fixed.flush();
+        wiegand.flush();
+    }
+
+    CHECK(recorder.events.size() > 100);
+    CHECK(recorder.events == fixed_recorder.events);
+}
+
+TEST(static_matches_wiegand) {
+    checkStaticMatchesWiegand<Wiegand::LENGTH_ANY, true>(1);
+    checkStaticMatchesWiegand<Wiegand::LENGTH_ANY, false>(2);
+    checkStaticMatchesWiegand<26, true>(3);
+    checkStaticMatchesWiegand<26, false>(4);
+    checkStaticMatchesWiegand<34, true>(5);
+    checkStaticMatchesWiegand<8, true>(6);
+    checkStaticMatchesWiegand<4, true>(7);
+    //A format known at compile time decodes the same as the registry
+    checkStaticMatchesWiegand<26, true, &WiegandFormats::H10301>(8);
+    checkStaticMatchesWiegand<Wiegand::LENGTH_ANY, true, &WiegandFormats::H10306>(9);
+}
+
+/**
+ * A random frame of `bits` bits, as a string of '0' and '1'
+ */
+static std::string randomFrame(uint16_t bits, uint32_t seed) {
+    std::string frame;
+    for (uint16_t i=0; i<bits; i++) {
+        seed = seed * 1103515245 + 12345;
+        frame += (seed >> 16) & 1 ? '1' : '0';
+    }
+    return frame;
+}
+
+/**
+ * How `Recorder` prints a frame received without decoding
+ */
+static std::string rawPayload(const std::string& frame) {
+    std::vector<uint8_t> data((frame.size() + 7) / 8, 0);
+    size_t padding = 8*data.size() - frame.size();
+    for (size_t i=0; i<frame.size(); i++) {
+        if (frame[i] == '1') {
+            data[(padding + i) / 8] |= 0x80 >> ((padding + i) % 8);
+        }
+    }
+    return formatPayload(data.data(), frame.size());
+}
+
+TEST(static_large_frames) {
+    //200-bit FASC-N, with an 8-bit counter
+    StaticWiegand<Wiegand::LENGTH_ANY, false, 200> fascn;
+    Recorder recorder;
+    recorder.attach(fascn);
+    fascn.begin();
+    connectReader(fascn);
+
+    for (uint16_t bits : {26, 64, 65, 128, 199, 200}) {
+        std::string frame = randomFrame(bits, bits);
+        sendFrame(fascn, frame.c_str());
+        finishFrame(fascn);
+        CHECK_EQUAL(rawPayload(frame), recorder.last());
+    }
+    sendFrame(fascn, randomFrame(201, 1).c_str());
+    finishFrame(fascn);
+    CHECK_EQUAL(std::string("1!200:"), recorder.last().substr(0, 6));
+
+    //Over 255 bits needs a 16-bit counter
+    StaticWiegand<300, false, 300, uint16_t> huge;
+    recorder.attach(huge);
+    huge.begin();
+    connectReader(huge);
+
+    std::string frame = randomFrame(300, 3);
+    sendFrame(huge, frame.c_str());
+    CHECK_EQUAL(rawPayload(frame), recorder.last());
+    CHECK_EQUAL(std::string("300:"), recorder.last().substr(0, 4));
+
+    //Card formats are limited to 64 bits
+    StaticWiegand<Wiegand::LENGTH_ANY, true, 300, uint16_t> decoded;
+    recorder.attach(decoded);
+    decoded.begin();
+    connectReader(decoded);
+    sendFrame(decoded, frame.c_str());
+    finishFrame(decoded);
+    CHECK_EQUAL("3!" + rawPayload(frame), recorder.last());
+}
+
+TEST(static_small_frames) {
+    StaticWiegand<Wiegand::LENGTH_ANY, true, 40> small;
+    Recorder recorder;
+    recorder.attach(small);
+    small.begin();
+    connectReader(small);
+
+    //H10304: Facility 1, card 2
+    sendFrame(small, "1000000000000000100000000000000000100");
+    finishFrame(small);
+    CHECK_EQUAL(std::string("35:0000080002"), recorder.last());
+
+    sendFrame(small, randomFrame(41, 1).c_str());
+    finishFrame(small);
+    CHECK_EQUAL(std::string("1!40:"), recorder.last().substr(0, 5));
+
+    //RAM follows the buffer size
+    CHECK(sizeof(StaticWiegand<Wiegand::LENGTH_ANY, true, 40>) < sizeof(StaticWiegand<>));
+    CHECK(sizeof(StaticWiegand<Wiegand::LENGTH_ANY, true, 200>) > sizeof(StaticWiegand<>));
+    CHECK_EQUAL(5, (StaticWiegand<Wiegand::LENGTH_ANY, true, 40>::MAX_BYTES));
+    CHECK_EQUAL(25, (StaticWiegand<Wiegand::LENGTH_ANY, true, 200>::MAX_BYTES));
+}
+
+TEST(static_constructor) {
+    //Instances that aren't globals start on whatever was in memory
+    alignas(StaticWiegand<>) uint8_t memory[sizeof(StaticWiegand<>)];
+    memset(memory, 0xA5, sizeof(memory));
+    StaticWiegand<>* wiegand = new (memory) StaticWiegand<>;
+    CHECK(!*wiegand);
+    unsigned long deadline;
+    CHECK(!wiegand->nextDeadline(deadline));
+
+    //No callbacks attached: Nothing to call
+    wiegand->begin();
+    connectReader(*wiegand);
+    sendFrame(*wiegand, "10000000000000000000000100");
+    finishFrame(*wiegand);
+    CHECK(*wiegand);
+    wiegand->~StaticWiegand<>();
+}
@@ -0,0 +1,225 @@
+#include "harness.h"
+#include "recorder.h"
+#include <HostTimer.h>
+#include <StaticWiegand.h>
+#include <TimedWiegand.h>
+#include <WiegandTiming.h>
+
+template<typename Decoder> static void timerExpired(Decoder* wiegand) {
+    wiegand->timerExpired();
+}
+
+/**
+ * Sends a frame and waits, without ever calling `flush()`
+ */
+template<typename Decoder> static void sendAndWait(Decoder& wiegand, const char* bits, unsigned long millis) {
+    sendFrame(wiegand, bits);
+    HostClock::advanceMillis(millis);
+}
+
+TEST(timed_ends_message_without_flush) {
+    HostTimer timer;
+    TimedWiegand<HostTimer> wiegand(timer);
+    timer.onExpire(timerExpired<TimedWiegand<HostTimer> >, &wiegand);
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin(Wiegand::LENGTH_ANY, false);
+
+    //The connection settles without the timer: The next pin change ends it
+    wiegand.setPin0State(true);
+    wiegand.setPin1State(true);
+    CHECK(!timer.running());
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    CHECK_EQUAL(1u, recorder.events.size());
+    CHECK(bool(wiegand));
+
+    sendFrame(wiegand, "1010");
+    //The last bit is 1.95ms old: Still waiting for more
+    HostClock::advanceMillis(Wiegand::TIMEOUT - 2);
+    CHECK_EQUAL(1u, recorder.events.size());
+    CHECK(timer.running());
+
+    //Exactly one timer delay after the last pin change
+    HostClock::advanceMillis(2);
+    CHECK_EQUAL(std::string("4:0a"), recorder.last());
+    CHECK(!timer.running());
+
+    //Nothing else happens while the line is quiet
+    unsigned long expirations = timer.expirations();
+    HostClock::advanceMillis(1000);
+    CHECK_EQUAL(expirations, timer.expirations());
+    CHECK_EQUAL(2u, recorder.events.size());
+}
+
+TEST(timed_message_latency) {
+    HostTimer timer;
+    TimedWiegand<HostTimer> wiegand(timer);
+    timer.onExpire(timerExpired<TimedWiegand<HostTimer> >, &wiegand);
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin();
+    connectReader(wiegand);
+
+    //26-bit H10301, FC=1, CN=2, with the message delivered as soon as the line has been quiet for the timeout
+    sendFrame(wiegand, "10000000100000000000000100");
+    unsigned long last_edge = wiegand.lastEventTime();
+    for (int i=0; i<1000 && recorder.events.size() < 2; i++) {
+        HostClock::advance(100);
+    }
+    CHECK_EQUAL(std::string("24:010002"), recorder.last());
+    CHECK(millis() - last_edge <= Wiegand::TIMEOUT + 1u);
+
+    //Several frames in a row
+    sendAndWait(wiegand, "00000001100000000000001000", Wiegand::TIMEOUT + 1);
+    CHECK_EQUAL(std::string("24:030004"), recorder.last());
+    sendAndWait(wiegand, "10000000100000000000000100", Wiegand::TIMEOUT + 1);
+    CHECK_EQUAL(std::string("24:010002"), recorder.last());
+    CHECK_EQUAL(4u, recorder.events.size());
+}
+
+TEST(timed_end_stops_timer) {
+    HostTimer timer;
+    TimedWiegand<HostTimer> wiegand(timer);
+    timer.onExpire(timerExpired<TimedWiegand<HostTimer> >, &wiegand);
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin(Wiegand::LENGTH_ANY, false);
+    connectReader(wiegand);
+
+    sendFrame(wiegand, "1010");
+    unsigned long expirations = timer.expirations();
+    wiegand.end();
+    CHECK(!timer.running());
+    HostClock::advanceMillis(1000);
+    CHECK_EQUAL(expirations, timer.expirations());
+    CHECK_EQUAL(std::string("+"), recorder.last());
+}
+
+/**
+ * Reports both pins on every change, like an interruption handler shared by both pins
+ */
+template<typename Decoder> static void sendBothPins(Decoder& wiegand, const char* bits) {
+    for (const char* c = bits; *c; c++) {
+        wiegand.setPinState(0, *c == '1');
+        wiegand.setPinState(1, *c == '0');
+        HostClock::advance(50);
+        wiegand.setPinState(0, true);
+        wiegand.setPinState(1, true);
+        HostClock::advance(1950);
+    }
+}
+
+template<typename Decoder> static void checkTimerOnlyOnChanges() {
+    HostTimer timer;
+    Decoder wiegand(timer);
+    timer.onExpire(timerExpired<Decoder>, &wiegand);
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin();
+    connectReader(wiegand);
+
+    //2 changes per bit, the first one before the message starts: The pins that didn't change don't touch the timer
+    unsigned long starts = timer.starts();
+    sendBothPins(wiegand, "0110");
+    CHECK_EQUAL(starts + 7, timer.starts());
+    wiegand.setPinState(1, true, Wiegand::now());
+    CHECK_EQUAL(starts + 7, timer.starts());
+    HostClock::advanceMillis(Wiegand::TIMEOUT);
+    CHECK_EQUAL(std::string("4:06"), recorder.last());
+}
+
+TEST(timed_ignores_unchanged_pins) {
+    checkTimerOnlyOnChanges<TimedWiegand<HostTimer> >();
+    checkTimerOnlyOnChanges<TimedWiegand<HostTimer, StaticWiegand<> > >();
+}
+
+TEST(timed_static_decoder) {
+    typedef TimedWiegand<HostTimer, StaticWiegand<> > Decoder;
+    HostTimer timer;
+    Decoder wiegand(timer);
+    timer.onExpire(timerExpired<Decoder>, &wiegand);
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin();
+    connectReader(wiegand);
+
+    sendAndWait(wiegand, "10000000100000000000000100", Wiegand::TIMEOUT + 1);
+    CHECK_EQUAL(std::string("24:010002"), recorder.last());
+}
+
+TEST(timed_two_readers) {
+    HostTimer timer_a, timer_b;
+    TimedWiegand<HostTimer> reader_a(timer_a), reader_b(timer_b);
+    timer_a.onExpire(timerExpired<TimedWiegand<HostTimer> >, &reader_a);
+    timer_b.onExpire(timerExpired<TimedWiegand<HostTimer> >, &reader_b);
+    Recorder recorder_a, recorder_b;
+    recorder_a.attach(reader_a);
+    recorder_b.attach(reader_b);
+    reader_a.begin(Wiegand::LENGTH_ANY, false);
+    reader_b.begin(Wiegand::LENGTH_ANY, false);
+    connectReader(reader_a);
+    connectReader(reader_b);
+
+    //Each reader ends its own message, on its own timer
+    sendFrame(reader_a, "1010");
+    HostClock::advanceMillis(10);
+    sendFrame(reader_b, "0101");
+    HostClock::advanceMillis(Wiegand::TIMEOUT - 10);
+    CHECK_EQUAL(std::string("4:0a"), recorder_a.last());
+    CHECK_EQUAL(std::string("+"), recorder_b.last());
+    HostClock::advanceMillis(10);
+    CHECK_EQUAL(std::string("4:05"), recorder_b.last());
+}
+
+TEST(timed_instance_timeouts) {
+    HostTimer timer;
+    TimedWiegand<HostTimer> wiegand(timer);
+    timer.onExpire(timerExpired<TimedWiegand<HostTimer> >, &wiegand);
+    Recorder recorder;
+    recorder.attach(wiegand);
+    WiegandTiming timing;
+    timing.setTimeouts(600, 0, 1000, true);
+    wiegand.setTiming(&timing);
+    wiegand.begin(Wiegand::LENGTH_ANY, false);
+
+    wiegand.setPin0State(true);
+    wiegand.setPin1State(true);
+    HostClock::advance(1001);
+    CHECK(bool(wiegand));
+
+    for (const char* c = "1010"; *c; c++) {
+        wiegand.setPinState(*c == '1', false);
+        HostClock::advance(50);
+        wiegand.setPinState(*c == '1', true);
+        HostClock::advance(150);
+    }
+    //The timer follows the frame gap of the instance, in microseconds
+    CHECK(timer.running());
+    HostClock::advance(450);
+    CHECK_EQUAL(std::string("+"), recorder.last());
+    HostClock::advance(2);
+    CHECK_EQUAL(std::string("4:0a"), recorder.last());
+    CHECK(!timer.running());
+}
+
+TEST(timed_adaptive_timeout) {
+    HostTimer timer;
+    TimedWiegand<HostTimer> wiegand(timer);
+    timer.onExpire(timerExpired<TimedWiegand<HostTimer> >, &wiegand);
+    Recorder recorder;
+    recorder.attach(wiegand);
+    WiegandTiming timing;
+    timing.setTimeouts(Wiegand::TIMEOUT * 1000UL, 0, Wiegand::TIMEOUT * 1000UL, true);
+    timing.setAdaptiveTimeout(4, 500, Wiegand::TIMEOUT * 1000UL);
+    wiegand.setTiming(&timing);
+    wiegand.begin(Wiegand::LENGTH_ANY, false);
+    connectReader(wiegand);
+
+    //A reader sending a bit every 2ms has its messages sent out 8ms after the last bit, instead of the fixed timeout
+    sendFrame(wiegand, "1010");
+    HostClock::advance(8000 - 1950);
+    CHECK_EQUAL(std::string("+"), recorder.last());
+    HostClock::advance(2);
+    CHECK_EQUAL(std::string("4:0a"), recorder.last());
+    CHECK(!timer.running());
+}
@@ -0,0 +1,684 @@
+#include "harness.h"
+#include "recorder.h"
+#include <WiegandTiming.h>
+
+/**
+ * Builds a 26/34-bit frame with valid parity around `payload`, which is also written as a string of '0' and '1'
+ */
+static std::string withParity(const std::string& payload) {
+    size_t half = payload.size() / 2;
+    int left = 0, right = 1;
+    for (size_t i=0; i<half; i++) {
+        left ^= payload[i] == '1';
+    }
+    for (size_t i=half; i<payload.size(); i++) {
+        right ^= payload[i] == '1';
+    }
+    return std::string(left ? "1" : "0") + payload + (right ? "1" : "0");
+}
+
+TEST(connection_events) {
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin();
+    CHECK(!wiegand);
+
+    connectReader(wiegand);
+    CHECK(wiegand);
+    CHECK_EQUAL(std::string("+"), recorder.last());
+
+    wiegand.setPin0State(false);
+    wiegand.setPin1State(false);
+    CHECK(!wiegand);
+    CHECK_EQUAL(std::string("-"), recorder.last());
+    CHECK_EQUAL(2u, recorder.events.size());
+}
+
+TEST(decode_26_expected_length) {
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin(26);
+    connectReader(wiegand);
+
+    sendFrame(wiegand, withParity("000000010000000000000001").c_str());
+    CHECK_EQUAL(std::string("24:010001"), recorder.last());
+}
+
+TEST(decode_26_length_any) {
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin();
+    connectReader(wiegand);
+
+    sendFrame(wiegand, withParity("101010111100110111101111").c_str());
+    wiegand.flush();
+    CHECK_EQUAL(std::string("+"), recorder.last());
+    finishFrame(wiegand);
+    CHECK_EQUAL(std::string("24:abcdef"), recorder.last());
+}
+
+TEST(decode_34) {
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin(34);
+    connectReader(wiegand);
+
+    sendFrame(wiegand, withParity("11011110101011011011111011101111").c_str());
+    CHECK_EQUAL(std::string("32:deadbeef"), recorder.last());
+
+    std::string bad_right = withParity("11011110101011011011111011101111");
+    bad_right[33] = bad_right[33] == '1' ? '0' : '1';
+    sendFrame(wiegand, bad_right.c_str());
+    CHECK_EQUAL(std::string("4!"), recorder.last().substr(0, 2));
+}
+
+TEST(parity_error) {
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin(26);
+    connectReader(wiegand);
+
+    sendFrame(wiegand, "00000000100000000000000010");
+    CHECK_EQUAL(std::string("4!26:00020002"), recorder.last());
+}
+
+TEST(raw_messages) {
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin(26, false);
+    connectReader(wiegand);
+
+    sendFrame(wiegand, "00000000100000000000000010");
+    CHECK_EQUAL(std::string("26:00020002"), recorder.last());
+}
+
+TEST(raw_messages_all_lengths) {
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin(Wiegand::LENGTH_ANY, false);
+    connectReader(wiegand);
+
+    uint32_t seed = 7;
+    for (int bits=1; bits<=Wiegand::MAX_BITS; bits++) {
+        std::string frame;
+        uint8_t expected[Wiegand::MAX_BYTES] = {0};
+        int padding = 8*((bits+7)/8) - bits;
+        for (int i=0; i<bits; i++) {
+            seed = seed * 1103515245 + 12345;
+            bool bit = (seed >> 16) & 1;
+            frame += bit ? '1' : '0';
+            if (bit) {
+                expected[(padding + i) / 8] |= 0x80 >> ((padding + i) % 8);
+            }
+        }
+        sendFrame(wiegand, frame.c_str());
+        finishFrame(wiegand);
+        CHECK_EQUAL(formatPayload(expected, bits), recorder.last());
+    }
+}
+
+TEST(keypad) {
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin();
+    connectReader(wiegand);
+
+    sendFrame(wiegand, "0111");
+    finishFrame(wiegand);
+    CHECK_EQUAL(std::string("4:07"), recorder.last());
+
+    sendFrame(wiegand, "10100101");
+    finishFrame(wiegand);
+    CHECK_EQUAL(std::string("4:05"), recorder.last());
+
+    sendFrame(wiegand, "10110101");
+    finishFrame(wiegand);
+    CHECK_EQUAL(std::string("4!8:b5"), recorder.last());
+}
+
+TEST(size_errors) {
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin(26);
+    connectReader(wiegand);
+
+    sendFrame(wiegand, "1011");
+    finishFrame(wiegand);
+    CHECK_EQUAL(std::string("2!4:0b"), recorder.last());
+
+    wiegand.begin();
+    connectReader(wiegand);
+    sendFrame(wiegand, "101");
+    finishFrame(wiegand);
+    CHECK_EQUAL(std::string("3!3:05"), recorder.last());
+
+    std::string huge(Wiegand::MAX_BITS + 6, '1');
+    sendFrame(wiegand, huge.c_str());
+    finishFrame(wiegand);
+    CHECK_EQUAL(std::string("1!64:ffffffffffffffff"), recorder.last());
+}
+
+TEST(communication_error_after_begin) {
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.setPin0State(true);
+    wiegand.setPin1State(true);
+    wiegand.begin();
+
+    sendFrame(wiegand, "0110");
+    finishFrame(wiegand);
+    CHECK_EQUAL(std::string("0!4:06"), recorder.last());
+
+    sendFrame(wiegand, "0110");
+    finishFrame(wiegand);
+    CHECK_EQUAL(std::string("4:06"), recorder.last());
+}
+
+static unsigned long fake_time = 0;
+static unsigned long fakeClock() {
+    return fake_time;
+}
+
+TEST(timestamped_replay) {
+    //A recorded trace: (time, pin, level), two messages 100ms apart
+    static const struct { unsigned long time; uint8_t pin; bool level; } trace[] = {
+        {1000, 0, true}, {1000, 1, true},
+        {1100, 1, false}, {1100, 1, true}, {1102, 0, false}, {1102, 0, true},
+        {1104, 1, false}, {1104, 1, true}, {1106, 1, false}, {1106, 1, true},
+        {1206, 0, false}, {1206, 0, true}, {1208, 0, false}, {1208, 0, true},
+        {1210, 1, false}, {1210, 1, true}, {1212, 0, false}, {1212, 0, true},
+    };
+
+    //The time source is only used by `begin()` and the last `flush()`
+    Wiegand::setTimeSource(fakeClock);
+    fake_time = 900;
+
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin();
+    for (auto& change : trace) {
+        wiegand.setPinState(change.pin, change.level, change.time);
+    }
+    CHECK_EQUAL(std::string("4:0b"), recorder.last());
+
+    fake_time = 1212 + Wiegand::TIMEOUT + 1;
+    wiegand.flush();
+    CHECK_EQUAL(std::string("4:02"), recorder.last());
+    CHECK_EQUAL(3u, recorder.events.size());
+
+    Wiegand::setTimeSource(nullptr);
+    CHECK_EQUAL(millis(), Wiegand::now());
+}
+
+/**
+ * Sends a frame with bits `interval` microseconds apart
+ */
+static void sendSlowFrame(Wiegand& wiegand, const char* bits, unsigned long interval) {
+    for (const char* c = bits; *c; c++) {
+        wiegand.setPinState(*c == '1', false);
+        HostClock::advance(50);
+        wiegand.setPinState(*c == '1', true);
+        HostClock::advance(interval - 50);
+    }
+}
+
+TEST(adaptive_timeout) {
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    WiegandTiming timing;
+    wiegand.setTiming(&timing);
+    timing.setAdaptiveTimeout(4);
+    wiegand.begin();
+    connectReader(wiegand);
+    CHECK_EQUAL(0u, timing.bitPeriod());
+
+    //2ms between bits: The message ends 8ms after the last bit, even the first one
+    sendFrame(wiegand, withParity("101010111100110111101111").c_str());
+    CHECK_EQUAL(2u, timing.bitPeriod());
+    HostClock::advanceMillis(6);
+    wiegand.flush();
+    CHECK_EQUAL(std::string("+"), recorder.last());
+    HostClock::advanceMillis(2);
+    wiegand.flush();
+    CHECK_EQUAL(std::string("24:abcdef"), recorder.last());
+
+    //A slower reader is followed right away, and never cut short.
+    //Gaps up to `max_timeout` may be bits of a slower reader, so this one starts well after that
+    HostClock::advanceMillis(Wiegand::TIMEOUT);
+    sendSlowFrame(wiegand, withParity("000000010000000000000001").c_str(), 5000);
+    CHECK_EQUAL(5u, timing.bitPeriod());
+    HostClock::advanceMillis(15);
+    wiegand.flush();
+    CHECK_EQUAL(std::string("24:abcdef"), recorder.last());
+    HostClock::advanceMillis(5);
+    wiegand.flush();
+    CHECK_EQUAL(std::string("24:010001"), recorder.last());
+
+    //...but it only comes back down slowly
+    HostClock::advanceMillis(Wiegand::TIMEOUT);
+    sendFrame(wiegand, "0110");
+    CHECK(timing.bitPeriod() > 2u && timing.bitPeriod() < 5u);
+    finishFrame(wiegand);
+    CHECK_EQUAL(std::string("4:06"), recorder.last());
+
+    //A different reader may be plugged next
+    wiegand.setPin0State(false);
+    wiegand.setPin1State(false);
+    CHECK_EQUAL(0u, timing.bitPeriod());
+}
+
+TEST(adaptive_timeout_limits) {
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    WiegandTiming timing;
+    wiegand.setTiming(&timing);
+    timing.setAdaptiveTimeout(4, 6, 20);
+    wiegand.begin(Wiegand::LENGTH_ANY, false);
+    connectReader(wiegand);
+
+    //1ms between bits: Still waits for `min_timeout`
+    sendSlowFrame(wiegand, "1010", 1000);
+    HostClock::advanceMillis(4);
+    wiegand.flush();
+    CHECK_EQUAL(std::string("+"), recorder.last());
+    HostClock::advanceMillis(2);
+    wiegand.flush();
+    CHECK_EQUAL(std::string("4:0a"), recorder.last());
+
+    //Another reader: 8ms between bits would be 32ms, but `max_timeout` is 20ms
+    wiegand.setPin0State(false);
+    wiegand.setPin1State(false);
+    connectReader(wiegand);
+    sendSlowFrame(wiegand, "0101", 8000);
+    HostClock::advanceMillis(14);
+    wiegand.flush();
+    CHECK_EQUAL(std::string("4:05"), recorder.last());
+
+    //Back to the fixed timeout
+    timing.setAdaptiveTimeout(0);
+    sendFrame(wiegand, "0110");
+    HostClock::advanceMillis(Wiegand::TIMEOUT - 2);
+    wiegand.flush();
+    CHECK_EQUAL(std::string("4:05"), recorder.last());
+    finishFrame(wiegand);
+    CHECK_EQUAL(std::string("4:06"), recorder.last());
+}
+
+TEST(adaptive_timeout_microseconds) {
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    WiegandTiming timing;
+    wiegand.setTiming(&timing);
+    timing.setTimeouts(Wiegand::TIMEOUT * 1000UL, 0, Wiegand::TIMEOUT * 1000UL, true);
+    timing.setAdaptiveTimeout(4);
+    wiegand.begin(Wiegand::LENGTH_ANY, false);
+    connectReader(wiegand);
+
+    //The default limits are converted: 2ms between bits still ends messages 8ms after the last bit
+    sendSlowFrame(wiegand, "0110", 2000);
+    CHECK_EQUAL(2000u, timing.bitPeriod());
+    HostClock::advance(5900);
+    wiegand.flush();
+    CHECK_EQUAL(std::string("+"), recorder.last());
+    HostClock::advance(200);
+    wiegand.flush();
+    CHECK_EQUAL(std::string("4:06"), recorder.last());
+
+    //0.5ms between bits: Waits for the default `min_timeout` of 4ms
+    wiegand.setPin0State(false);
+    wiegand.setPin1State(false);
+    connectReader(wiegand);
+    sendSlowFrame(wiegand, "1010", 500);
+    HostClock::advance(3400);
+    wiegand.flush();
+    CHECK_EQUAL(std::string("+"), recorder.last());
+    HostClock::advance(200);
+    wiegand.flush();
+    CHECK_EQUAL(std::string("4:0a"), recorder.last());
+}
+
+TEST(microseconds_time_source) {
+    //Instances in microseconds read the time from their own source, not from `micros()` or the milliseconds source
+    Wiegand::setMicrosSource(fakeClock);
+    fake_time = 5000;
+
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    WiegandTiming timing;
+    timing.setTimeouts(600, 0, 1000, true);
+    wiegand.setTiming(&timing);
+    wiegand.begin(Wiegand::LENGTH_ANY, false);
+    CHECK_EQUAL(5000u, wiegand.time());
+    CHECK_EQUAL(5000u, wiegand.lastEventTime());
+
+    wiegand.setPin0State(true);
+    wiegand.setPin1State(true);
+    CHECK_EQUAL(5000u, wiegand.lastEventTime());
+    fake_time += 1001;
+    wiegand.flush();
+    const char* bits = "0110";
+    for (const char* c = bits; *c; c++) {
+        wiegand.setPinState(*c == '1', false);
+        fake_time += 50;
+        wiegand.setPinState(*c == '1', true);
+        fake_time += 150;
+    }
+    fake_time += 450;
+    wiegand.flush();
+    CHECK_EQUAL(std::string("+"), recorder.last());
+    fake_time += 1;
+    wiegand.flush();
+    CHECK_EQUAL(std::string("4:06"), recorder.last());
+
+    Wiegand::setMicrosSource(nullptr);
+    CHECK_EQUAL(micros(), Wiegand::nowMicros());
+    CHECK_EQUAL(micros(), wiegand.time());
+}
+
+TEST(adaptive_timeout_slows_down) {
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    WiegandTiming timing;
+    wiegand.setTiming(&timing);
+    timing.setAdaptiveTimeout(4);
+    wiegand.begin();
+    connectReader(wiegand);
+
+    //Learns a 2ms reader: Messages end 8ms after their last bit
+    sendFrame(wiegand, withParity("101010111100110111101111").c_str());
+    finishFrame(wiegand);
+    CHECK_EQUAL(std::string("24:abcdef"), recorder.last());
+    CHECK_EQUAL(2u, timing.bitPeriod());
+
+    //Same reader, now 10ms between bits, without being disconnected: The first gap cuts its message, but it is learned
+    sendSlowFrame(wiegand, withParity("000000010000000000000001").c_str(), 10000);
+    finishFrame(wiegand);
+    CHECK_EQUAL(10u, timing.bitPeriod());
+
+    //From then on, its messages are received whole
+    size_t events = recorder.events.size();
+    sendSlowFrame(wiegand, withParity("000000010000000000000001").c_str(), 10000);
+    finishFrame(wiegand);
+    CHECK_EQUAL(events + 1, recorder.events.size());
+    CHECK_EQUAL(std::string("24:010001"), recorder.last());
+    sendSlowFrame(wiegand, withParity("000000010000000000000010").c_str(), 10000);
+    finishFrame(wiegand);
+    CHECK_EQUAL(std::string("24:010002"), recorder.last());
+    CHECK_EQUAL(10u, timing.bitPeriod());
+}
+
+TEST(instance_timeouts) {
+    //A fast reader, timed in microseconds, next to a legacy one on the default timeouts
+    Wiegand fast = Wiegand(), legacy = Wiegand();
+    Recorder fast_recorder, legacy_recorder;
+    fast_recorder.attach(fast);
+    legacy_recorder.attach(legacy);
+    WiegandTiming fast_timing;
+    fast_timing.setTimeouts(600, 300, 1000, true);
+    fast.setTiming(&fast_timing);
+    fast.begin(Wiegand::LENGTH_ANY, false);
+    legacy.begin(Wiegand::LENGTH_ANY, false);
+    CHECK_EQUAL(micros(), fast.time());
+    CHECK_EQUAL(millis(), legacy.time());
+
+    //The connection settles in 1ms
+    fast.setPin0State(true);
+    fast.setPin1State(true);
+    connectReader(legacy);
+    CHECK_EQUAL(micros(), fast.lastEventTime() + (Wiegand::TIMEOUT + 1) * 1000UL);
+    fast.flush();
+    CHECK(fast);
+
+    //200us between bits, the message ends 600us after the last one
+    sendSlowFrame(fast, "1010", 200);
+    sendFrame(legacy, "0101");
+    fast.flush();
+    CHECK_EQUAL(std::string("4:0a"), fast_recorder.last());
+    legacy.flush();
+    CHECK_EQUAL(std::string("+"), legacy_recorder.last());
+    finishFrame(legacy);
+    CHECK_EQUAL(std::string("4:05"), legacy_recorder.last());
+
+    sendSlowFrame(fast, "0110", 200);
+    HostClock::advance(300);
+    fast.flush();
+    CHECK_EQUAL(std::string("4:0a"), fast_recorder.last());
+    HostClock::advance(200);
+    fast.flush();
+    CHECK_EQUAL(std::string("4:06"), fast_recorder.last());
+
+    //A bit 500us late: Still the same message, but it stalled
+    sendSlowFrame(fast, "01", 200);
+    HostClock::advance(300);
+    sendSlowFrame(fast, "10", 200);
+    HostClock::advance(1000);
+    fast.flush();
+    CHECK_EQUAL(std::string("0!4:06"), fast_recorder.last());
+}
+
+TEST(settle_time) {
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    WiegandTiming timing;
+    wiegand.setTiming(&timing);
+    timing.setTimeouts(Wiegand::TIMEOUT, 0, 100);
+    wiegand.begin(Wiegand::LENGTH_ANY, false);
+
+    //Bits sent before the reader settles are garbage
+    wiegand.setPin0State(true);
+    wiegand.setPin1State(true);
+    HostClock::advanceMillis(50);
+    sendFrame(wiegand, "0110");
+    finishFrame(wiegand);
+    CHECK_EQUAL(std::string("0!4:06"), recorder.last());
+
+    HostClock::advanceMillis(75);
+    wiegand.flush();
+    sendFrame(wiegand, "0110");
+    finishFrame(wiegand);
+    CHECK_EQUAL(std::string("4:06"), recorder.last());
+}
+
+TEST(long_idle) {
+    //More than half the range of the clock, as 35.8 minutes are for a 32-bit `micros()`
+    const unsigned long HALF_RANGE = (~0UL >> 1) + 1;
+    unsigned long start = micros();
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    WiegandTiming timing;
+    timing.setTimeouts(2500, 0, 2500, true);
+    wiegand.setTiming(&timing);
+    wiegand.begin();
+
+    //Nobody calls `flush()`: The reader is still settling when the first card comes
+    wiegand.setPin0State(true);
+    wiegand.setPin1State(true);
+    HostClock::advance(HALF_RANGE + 1000);
+    sendFrame(wiegand, "10000000100000000000000100");
+    HostClock::advance(HALF_RANGE + 1000);
+    wiegand.flush();
+    CHECK_EQUAL(std::string("24:010002"), recorder.last());
+
+    HostClock::set(start);
+}
+
+static unsigned long clock_reads = 0;
+static unsigned long countingClock() {
+    clock_reads++;
+    return millis();
+}
+
+TEST(unchanged_pins_skip_clock) {
+    Wiegand::setTimeSource(countingClock);
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    wiegand.begin(26);
+    connectReader(wiegand);
+
+    //Like an interruption handler, report both pins on every change
+    std::string frame = withParity("000000010000000000000001");
+    clock_reads = 0;
+    for (char c : frame) {
+        uint8_t pin = c == '1';
+        for (int level=0; level<2; level++) {
+            wiegand.setPin0State(pin == 0 ? level : true);
+            wiegand.setPin1State(pin == 1 ? level : true);
+            HostClock::advance(1000);
+        }
+    }
+    CHECK_EQUAL(std::string("24:010001"), recorder.last());
+    CHECK_EQUAL(2*frame.size(), clock_reads);
+
+    //A message left pending ends on the next change, when its gap is over
+    wiegand.begin(Wiegand::LENGTH_ANY, false);
+    connectReader(wiegand);
+    sendFrame(wiegand, "0110");
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    sendFrame(wiegand, "1");
+    CHECK_EQUAL(std::string("4:06"), recorder.last());
+
+    Wiegand::setTimeSource(nullptr);
+}
+
+/**
+ * Sends a pulse `width` microseconds long on `pin`, then waits `after` microseconds
+ */
+static void sendPulse(Wiegand& wiegand, uint8_t pin, unsigned long width, unsigned long after) {
+    wiegand.setPinState(pin, false);
+    HostClock::advance(width);
+    wiegand.setPinState(pin, true);
+    HostClock::advance(after);
+}
+
+/**
+ * Sends a frame with 50us pulses 2ms apart, and a spike `spike_width` microseconds long after its 10th bit
+ */
+static void sendNoisyFrame(Wiegand& wiegand, const std::string& bits, unsigned long spike_width) {
+    for (size_t i=0; i<bits.size(); i++) {
+        sendPulse(wiegand, bits[i] == '1', 50, 1950);
+        if (i == 9) {
+            sendPulse(wiegand, 0, spike_width, 1950);
+        }
+    }
+}
+
+TEST(pulse_limits) {
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    WiegandTiming timing;
+    wiegand.setTiming(&timing);
+    timing.setTimeouts(Wiegand::TIMEOUT * 1000UL, 0, Wiegand::TIMEOUT * 1000UL, true);
+    timing.setPulseLimits(20, 200, 500);
+    wiegand.begin(26);
+    wiegand.setPin0State(true);
+    wiegand.setPin1State(true);
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    wiegand.flush();
+    CHECK(bool(wiegand));
+
+    //A spike, a pulse too long and a bit too soon are each rejected, without touching the frame, and only counted
+    std::string frame = withParity("000000010000000000000010");
+    for (size_t i=0; i<frame.size(); i++) {
+        sendPulse(wiegand, frame[i] == '1', 50, 150);
+        if (i == 5) {
+            sendPulse(wiegand, 0, 2, 0);
+        } else if (i == 10) {
+            sendPulse(wiegand, 1, 1000, 0);
+        } else if (i == 15) {
+            sendPulse(wiegand, 0, 50, 0);
+        }
+        HostClock::advance(1800);
+    }
+    CHECK_EQUAL(2u, recorder.events.size());
+    CHECK_EQUAL(std::string("24:010002"), recorder.last());
+    CHECK_EQUAL(3ul, timing.rejectedPulses());
+    CHECK_EQUAL(std::string("Pulse rejected"), std::string(Wiegand::DataErrorStr(Wiegand::PulseRejected)));
+
+    //A bit sent as a pulse too long is lost along with its message, which is reported once
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    for (size_t i=0; i<frame.size(); i++) {
+        sendPulse(wiegand, frame[i] == '1', i % 2 ? 1000 : 50, 150);
+        HostClock::advance(1800);
+    }
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    wiegand.flush();
+    CHECK_EQUAL(3u, recorder.events.size());
+    CHECK_EQUAL(std::string("5!13:"), recorder.last().substr(0, 5));
+    CHECK_EQUAL(16ul, timing.rejectedPulses());
+
+    //The next message doesn't inherit the rejections of the previous one
+    sendNoisyFrame(wiegand, withParity("0000000100000000"), 100);
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    wiegand.flush();
+    CHECK_EQUAL(4u, recorder.events.size());
+    CHECK_EQUAL(std::string("2!"), recorder.last().substr(0, 2));
+
+    //A pulse right on the limit is a bit, so the frame is lost
+    size_t events = recorder.events.size();
+    sendNoisyFrame(wiegand, withParity("000000010000000000000010"), 200);
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    wiegand.flush();
+    CHECK(recorder.events.size() > events);
+    for (size_t i=events; i<recorder.events.size(); i++) {
+        CHECK(recorder.events[i] != std::string("24:010002"));
+    }
+
+    //Without limits, so is a spike
+    events = recorder.events.size();
+    timing.setPulseLimits(0);
+    sendNoisyFrame(wiegand, withParity("000000010000000000000010"), 2);
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    wiegand.flush();
+    CHECK(recorder.events.size() > events);
+    for (size_t i=events; i<recorder.events.size(); i++) {
+        CHECK(recorder.events[i] != std::string("24:010002"));
+    }
+}
+
+TEST(pulse_rejected_while_idle) {
+    Wiegand wiegand = Wiegand();
+    Recorder recorder;
+    recorder.attach(wiegand);
+    WiegandTiming timing;
+    wiegand.setTiming(&timing);
+    timing.setTimeouts(Wiegand::TIMEOUT * 1000UL, 0, Wiegand::TIMEOUT * 1000UL, true);
+    timing.setPulseLimits(20, 200, 500);
+    wiegand.begin();
+    wiegand.setPin0State(true);
+    wiegand.setPin1State(true);
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    wiegand.flush();
+
+    //A spike on an idle line is only counted: The card after it has its own error
+    sendPulse(wiegand, 0, 2, 5000);
+    std::string card = withParity("000000010000000000000010");
+    card[3] = '1';
+    for (size_t i=0; i<card.size(); i++) {
+        sendPulse(wiegand, card[i] == '1', 50, 1950);
+    }
+    HostClock::advanceMillis(Wiegand::TIMEOUT + 1);
+    wiegand.flush();
+    CHECK_EQUAL(1ul, timing.rejectedPulses());
+    CHECK_EQUAL(2u, recorder.events.size());
+    CHECK_EQUAL(std::string("4!"), recorder.last().substr(0, 2));
+}
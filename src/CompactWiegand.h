@@ -0,0 +1,135 @@
+/*
+ * Wiegand decoder with the smallest RAM footprint.
+ *
+ * Works like `Wiegand`, with a few trade-offs to save RAM on boards that handle many readers:
+ * - A single handler receives every event (data, errors and state changes), with a single context pointer.
+ * - Timestamps are kept in 16 bits, wrapping every ~65 seconds: A gap that ends within `Wiegand::TIMEOUT` of
+ *   a multiple of that is taken as a short one.
+ * - The decoding mode is kept in the state flags, and the buffer is sized by `MAX_BITS`.
+ *
+ * On AVRs, the 64-bit version takes 21 bytes, against 42 bytes of `Wiegand`.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <Wiegand.h>
+#include <WiegandFrontEnd.h>
+
+/**
+ * `MAX_BITS` is the longest message accepted, up to 254 bits
+ */
+template<uint8_t MAX_BITS=Wiegand::MAX_BITS>
+class CompactWiegand : public WiegandFrontEnd<CompactWiegand<MAX_BITS>, MAX_BITS, uint8_t, uint16_t> {
+    static_assert(MAX_BITS > 0 && MAX_BITS < 0xFF, "MAX_BITS must be between 1 and 254");
+
+    typedef WiegandFrontEnd<CompactWiegand, MAX_BITS, uint8_t, uint16_t> FrontEnd;
+    friend FrontEnd;
+
+public:
+    using FrontEnd::MAX_BYTES;
+
+    /**
+     * What happened, as sent to the handler
+     */
+    enum Event : uint8_t {
+        Connected,
+        Disconnected,
+        Received,
+        // Errors, in the same order as `Wiegand::DataError`
+        CommunicationError,
+        SizeTooBigError,
+        SizeUnexpectedError,
+        DecodeFailedError,
+        VerificationFailedError
+    };
+
+    /**
+     * Receives all events. `data` and `bits` are only set for `Received` and errors
+     */
+    typedef void (*handler_t)(Event event, uint8_t* data, uint8_t bits, void* context);
+
+    /**
+     * Tells if an event is an error
+     */
+    static inline bool isError(Event event) {
+        return event >= CommunicationError;
+    }
+
+    /**
+     * Gets the `Wiegand::DataError` of an error event
+     */
+    static inline Wiegand::DataError dataError(Event event) {
+        return Wiegand::DataError(event - CommunicationError);
+    }
+
+    /**
+     * Size of the fields, without any padding. On 8-bit AVRs, it is the size of the object
+     */
+    static const uint8_t PACKED_SIZE = 3 + MAX_BYTES + sizeof(uint16_t) + sizeof(Wiegand::accumulator_t) + sizeof(handler_t) + sizeof(void*);
+
+private:
+    uint8_t expected_bits;
+    handler_t handler;
+    void* context;
+
+    inline void notify(Event event, uint8_t* data, uint8_t bits) {
+        if (handler) {
+            handler(event, data, bits, context);
+        }
+    }
+
+    inline uint8_t expectedBits() {
+        return expected_bits;
+    }
+
+    inline bool decodeMessages() {
+        return this->state & WiegandCore::DECODE_MESSAGES;
+    }
+
+    inline const WiegandFormat* fixedFormat() {
+        return nullptr;
+    }
+
+    inline bool wantsCredential() {
+        return false;
+    }
+
+    inline void dispatchMessage(uint8_t* data, uint8_t bits, const WiegandCredential* /*credential*/) {
+        notify(Received, data, bits);
+    }
+
+    inline void dispatchError(Wiegand::DataError error, uint8_t* data, uint8_t bits) {
+        notify(Event(CommunicationError + error), data, bits);
+    }
+
+    inline void dispatchState(bool plugged) {
+        notify(plugged ? Connected : Disconnected, nullptr, 0);
+    }
+
+public:
+    CompactWiegand() : expected_bits(0), handler(nullptr), context(nullptr) {}
+
+    /**
+    * Sets the device as "initialized" and resets it to wait a new message.
+    *
+    * `expected_bits` and `decode_messages` work the same as on `Wiegand::begin()`
+    */
+    void begin(uint8_t expected_bits=Wiegand::LENGTH_ANY, bool decode_messages=true) {
+        using namespace WiegandCore;
+#ifdef __AVR__
+        static_assert(sizeof(CompactWiegand) == PACKED_SIZE, "CompactWiegand has padding on AVR");
+#endif
+        static_assert(MAX_BITS > Wiegand::MAX_BITS || sizeof(CompactWiegand) < sizeof(Wiegand), "CompactWiegand is larger than Wiegand");
+
+        this->expected_bits = expected_bits;
+        this->initialize(decode_messages ? DECODE_MESSAGES : 0);
+    }
+
+    /**
+     * Attaches the handler of all events
+     */
+    template<typename T> void onEvent(void (*func)(Event event, uint8_t* data, uint8_t bits, T* context), T* context=nullptr) {
+        handler = (handler_t)func;
+        this->context = (void*)context;
+    }
+};
@@ -0,0 +1,126 @@
+/*
+ * Wiegand decoder with a lock-free edge queue between the interrupt handler and the main loop.
+ *
+ * The interrupt handler only records which pin changed, its new level and when it happened.
+ * All decoding, validation and callbacks happen later, when the main loop calls `process()`,
+ * so there is no need to disable interruptions around it.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <Wiegand.h>
+#include <WiegandRingBuffer.h>
+
+/**
+ * `QUEUE_SIZE` is the number of pin changes that can be pending between calls to `process()`.
+ * Each bit produces 2 of them (Pins that didn't change aren't recorded, even if the interrupt handler queues both),
+ * and the last one is reserved to mark where changes were lost, so the default is enough for 31 bits.
+ *
+ * It must be a power of 2, up to 128
+ */
+template<uint8_t QUEUE_SIZE=64>
+class DeferredWiegand : public Wiegand {
+public:
+    /**
+     * A pin change, as recorded by the interrupt handler
+     */
+    struct Edge {
+        unsigned long timestamp;
+        uint8_t flags;
+    };
+
+private:
+    static const uint8_t EDGE_PIN = 0x01;
+    static const uint8_t EDGE_OVERFLOW = 0x02;
+    static const uint8_t EDGE_LEVEL0 = 0x04;
+    static const uint8_t EDGE_LEVEL1 = 0x08;
+
+    WiegandRingBuffer<Edge, QUEUE_SIZE> edges;
+
+    /**
+     * Levels of both pins, as last recorded by the interrupt handler
+     */
+    uint8_t levels;
+
+public:
+    DeferredWiegand() : levels(0) {
+    }
+
+    /**
+     * Records that a pin has changed to `pin_state` at `timestamp` milliseconds (or microseconds, see `Wiegand::setTiming()`).
+     *
+     * This is safe to call from an interrupt handler, as long as there is only one of them for this instance.
+     * Pins that didn't change are skipped, so the handler may queue both pins on every interruption.
+     *
+     * If the queue is full, the change is lost, and the message being received
+     * will be reported as a `Communication` error. The next recorded change brings both pins back in sync.
+     */
+    inline void queuePinState(uint8_t pin, bool pin_state, unsigned long timestamp) {
+        uint8_t level = pin ? EDGE_LEVEL1 : EDGE_LEVEL0;
+        if (bool(levels & level) == pin_state) {
+            return;
+        }
+        levels ^= level;
+
+        //Each change carries the level of both pins, so that those lost while the queue was full are caught up with.
+        //The last free slot is reserved to mark where changes were lost
+        Edge edge;
+        edge.timestamp = timestamp;
+        edge.flags = levels | (pin ? EDGE_PIN : 0) | (edges.available() == 1 ? EDGE_OVERFLOW : 0);
+        edges.push(edge);
+    }
+
+    /**
+     * Records that a pin has changed to `pin_state` now.
+     */
+    inline void queuePinState(uint8_t pin, bool pin_state) {
+        queuePinState(pin, pin_state, time());
+    }
+
+    /**
+     * Records that the pin Data0 has changed to `pin_state`
+     */
+    inline void queuePin0State(bool pin_state) {
+        queuePinState(0, pin_state);
+    }
+
+    /**
+     * Records that the pin Data1 has changed to `pin_state`
+     */
+    inline void queuePin1State(bool pin_state) {
+        queuePinState(1, pin_state);
+    }
+
+    /**
+     * Number of pin changes waiting for `process()`
+     */
+    inline uint8_t pending() const {
+        return edges.size();
+    }
+
+    /**
+     * Decodes all recorded pin changes and sends out messages that have timed out.
+     *
+     * This replaces `flush()`, and must be called from the main loop, often enough to keep the queue from filling up.
+     */
+    void process() {
+        //Read the clock once the queue is empty: Changes recorded before are never newer than `now`,
+        //and those recorded after are never older, so they can't change what times out
+        unsigned long now;
+        Edge edge;
+        do {
+            while (edges.pop(edge)) {
+                //The pin that changed goes first. The other one only differs if changes were lost
+                uint8_t pin = edge.flags & EDGE_PIN;
+                setPinState(pin, edge.flags & (pin ? EDGE_LEVEL1 : EDGE_LEVEL0), edge.timestamp);
+                setPinState(!pin, edge.flags & (pin ? EDGE_LEVEL0 : EDGE_LEVEL1), edge.timestamp);
+                //Changes were lost after this one: Only once it is replayed, so that a message it ended isn't blamed
+                if (edge.flags & EDGE_OVERFLOW) {
+                    messageCorrupted();
+                }
+            }
+            now = time();
+        } while (edges.size());
+        flush(now);
+    }
+};
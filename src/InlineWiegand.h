@@ -0,0 +1,106 @@
+/*
+ * Wiegand decoder with handlers bound at compile time.
+ *
+ * Instead of registering callbacks, derive from `InlineWiegand` and define the handlers you need
+ * (CRTP). Handlers are called directly, so the compiler can inline them into the decoder,
+ * and no function or parameter pointers are kept in RAM:
+ *
+ *     class Reader : public InlineWiegand<Reader> {
+ *     public:
+ *         void onReceive(uint8_t* data, uint8_t bits) { ... }
+ *     };
+ *
+ * Handlers must be public. Those that aren't defined by the derived class do nothing.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <Wiegand.h>
+#include <WiegandFrontEnd.h>
+
+/**
+ * `Derived` is the class that defines the handlers.
+ * `MAX_BITS` is the longest message accepted, up to 254 bits
+ */
+template<typename Derived, uint8_t MAX_BITS=Wiegand::MAX_BITS>
+class InlineWiegand : public WiegandFrontEnd<Derived, MAX_BITS> {
+    static_assert(MAX_BITS > 0 && MAX_BITS < 0xFF, "MAX_BITS must be between 1 and 254");
+
+    typedef WiegandFrontEnd<Derived, MAX_BITS> FrontEnd;
+    friend FrontEnd;
+
+public:
+    using FrontEnd::MAX_BYTES;
+
+private:
+    uint8_t expected_bits;
+
+    /**
+     * Tells apart handlers defined by `Derived` from the default ones
+     */
+    static constexpr bool defined(void (InlineWiegand::*)(const WiegandCredential&)) {
+        return false;
+    }
+
+    template<typename F> static constexpr bool defined(F) {
+        return true;
+    }
+
+    inline uint8_t expectedBits() {
+        return expected_bits;
+    }
+
+    inline bool decodeMessages() {
+        return this->state & WiegandCore::DECODE_MESSAGES;
+    }
+
+    inline const WiegandFormat* fixedFormat() {
+        return nullptr;
+    }
+
+    /**
+     * Fields are only extracted for a derived class that defines `onCredential()`
+     */
+    inline bool wantsCredential() {
+        return defined(&Derived::onCredential);
+    }
+
+    inline void dispatchMessage(uint8_t* data, uint8_t bits, const WiegandCredential* credential) {
+        this->derived().onReceive(data, bits);
+        if (credential) {
+            this->derived().onCredential(*credential);
+        }
+    }
+
+    inline void dispatchError(Wiegand::DataError error, uint8_t* data, uint8_t bits) {
+        this->derived().onReceiveError(error, data, bits);
+    }
+
+    inline void dispatchState(bool plugged) {
+        this->derived().onStateChange(plugged);
+    }
+
+protected:
+    InlineWiegand() : expected_bits(0) {}
+
+    /**
+     * Default handlers: Define them on the derived class to receive the events.
+     * They work the same as the callbacks of `Wiegand`
+     */
+    inline void onReceive(uint8_t* /*data*/, uint8_t /*bits*/) {}
+    inline void onReceiveError(Wiegand::DataError /*error*/, uint8_t* /*data*/, uint8_t /*bits*/) {}
+    inline void onStateChange(bool /*plugged*/) {}
+    inline void onCredential(const WiegandCredential& /*credential*/) {}
+
+public:
+    /**
+    * Sets the device as "initialized" and resets it to wait a new message.
+    *
+    * `expected_bits` and `decode_messages` work the same as on `Wiegand::begin()`
+    */
+    void begin(uint8_t expected_bits=Wiegand::LENGTH_ANY, bool decode_messages=true) {
+        using namespace WiegandCore;
+        this->expected_bits = expected_bits;
+        this->initialize(decode_messages ? DECODE_MESSAGES : 0);
+    }
+};
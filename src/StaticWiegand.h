@@ -0,0 +1,149 @@
+/*
+ * Wiegand decoder with the configuration fixed at compile time.
+ *
+ * Works just like `Wiegand`, but the message size and decoding mode are template parameters
+ * instead of `begin()` arguments. Since they are constants, the compiler drops every branch
+ * that can't be taken (e.g., keypad messages on a 26-bit reader, or parity checks when
+ * messages aren't decoded), which makes both the interruption handler and the firmware smaller.
+ *
+ * The buffer size and the width of the bit counter are template parameters as well, so the
+ * RAM taken by each instance follows the longest message it must receive: A few bytes for
+ * 26-bit cards, or 25 bytes (and a 16-bit counter) for 200-bit FASC-N credentials.
+ */
+#pragma once
+
+#include <Wiegand.h>
+#include <WiegandFrontEnd.h>
+
+/**
+ * `EXPECTED_BITS` and `DECODE_MESSAGES` work the same as the arguments of `Wiegand::begin()`.
+ *
+ * `MAX_BITS` is the longest message accepted, and `bits_t` the type used to count bits:
+ * `uint8_t` goes up to 254 bits, use `uint16_t` for longer messages.
+ * Card formats only go up to 64 bits, longer messages must be received with `DECODE_MESSAGES=false`.
+ *
+ * `FORMAT` is the card format of the reader, e.g. `&WiegandFormats::H10301`. Messages of its size are decoded with it
+ * alone, with its parity masks and fields known at compile time, instead of looking up `WiegandFormats` on every message.
+ * Messages of other sizes are decoded as usual.
+ */
+template<uint16_t EXPECTED_BITS=Wiegand::LENGTH_ANY, bool DECODE_MESSAGES=true, uint16_t MAX_BITS=Wiegand::MAX_BITS, typename bits_t=uint8_t,
+         const WiegandFormat* FORMAT=nullptr>
+class StaticWiegand : public WiegandFrontEnd<StaticWiegand<EXPECTED_BITS, DECODE_MESSAGES, MAX_BITS, bits_t, FORMAT>, MAX_BITS, bits_t> {
+    static_assert(EXPECTED_BITS > 0, "EXPECTED_BITS must be a message size or Wiegand::LENGTH_ANY");
+    static_assert(EXPECTED_BITS <= MAX_BITS || EXPECTED_BITS == Wiegand::LENGTH_ANY, "EXPECTED_BITS is larger than MAX_BITS");
+    static_assert(MAX_BITS > 0 && MAX_BITS < bits_t(~bits_t(0)), "bits_t is too small for MAX_BITS");
+    static_assert(FORMAT == nullptr || DECODE_MESSAGES, "FORMAT needs DECODE_MESSAGES");
+
+    typedef WiegandFrontEnd<StaticWiegand, MAX_BITS, bits_t> FrontEnd;
+    friend FrontEnd;
+
+public:
+    typedef void (*data_callback)(uint8_t* data, bits_t bits, void* param);
+    typedef void (*data_error_callback)(Wiegand::DataError error, uint8_t* rawdata, bits_t bits, void* param);
+
+private:
+    data_callback func_data;
+    data_error_callback func_data_error;
+    Wiegand::state_callback func_state;
+    Wiegand::credential_callback func_credential;
+    void* func_data_param;
+    void* func_data_error_param;
+    void* func_state_param;
+    void* func_credential_param;
+
+    inline bits_t expectedBits() {
+        return EXPECTED_BITS;
+    }
+
+    inline bool decodeMessages() {
+        return DECODE_MESSAGES;
+    }
+
+    inline const WiegandFormat* fixedFormat() {
+        return FORMAT;
+    }
+
+    inline bool wantsCredential() {
+        return func_credential != nullptr;
+    }
+
+    inline void dispatchMessage(uint8_t* data, bits_t bits, const WiegandCredential* credential) {
+        if (func_data) {
+            func_data(data, bits, func_data_param);
+        }
+        if (credential) {
+            func_credential(*credential, func_credential_param);
+        }
+    }
+
+    inline void dispatchError(Wiegand::DataError error, uint8_t* data, bits_t bits) {
+        if (func_data_error) {
+            func_data_error(error, data, bits, func_data_error_param);
+        }
+    }
+
+    inline void dispatchState(bool plugged) {
+        if (func_state) {
+            func_state(plugged, func_state_param);
+        }
+    }
+
+public:
+    StaticWiegand() :
+        func_data(nullptr), func_data_error(nullptr), func_state(nullptr), func_credential(nullptr),
+        func_data_param(nullptr), func_data_error_param(nullptr), func_state_param(nullptr), func_credential_param(nullptr)
+    {}
+
+    /**
+    * Sets the device as "initialized" and resets it to wait a new message.
+    */
+    void begin() {
+        this->initialize(0);
+    }
+
+    /**
+     * Current time, in milliseconds. Same as `Wiegand::now()`
+     */
+    inline unsigned long time() {
+        return Wiegand::now();
+    }
+
+    /**
+     * Time is always in milliseconds, see `Wiegand::microseconds()`
+     */
+    inline bool microseconds() {
+        return false;
+    }
+
+    /**
+     * Attaches a Data Receive Callback.
+     */
+    template<typename T> void onReceive(void (*func)(uint8_t* data, bits_t bits, T* param), T* param=nullptr) {
+      func_data = (data_callback)func;
+      func_data_param = (void*)param;
+    }
+
+    /**
+     * Attaches a Data Transmission Error Callback.
+     */
+    template<typename T> void onReceiveError(void (*func)(Wiegand::DataError error, uint8_t* data, bits_t bits, T* param), T* param=nullptr) {
+      func_data_error = (data_error_callback)func;
+      func_data_error_param = (void*)param;
+    }
+
+    /**
+     * Attaches a Credential Callback.
+     */
+    template<typename T> void onCredential(void (*func)(const WiegandCredential& credential, T* param), T* param=nullptr) {
+      func_credential = (Wiegand::credential_callback)func;
+      func_credential_param = (void*)param;
+    }
+
+    /**
+     * Attaches a State Change Callback.
+     */
+    template<typename T> void onStateChange(void (*func)(bool plugged, T* param), T* param=nullptr) {
+      func_state = (Wiegand::state_callback)func;
+      func_state_param = (void*)param;
+    }
+};
@@ -0,0 +1,110 @@
+/*
+ * Wiegand decoder that ends messages from a one-shot timer, instead of a polled `flush()`.
+ *
+ * With `LENGTH_ANY`, a message only ends when `flush()` notices `Wiegand::TIMEOUT` has passed
+ * since the last bit, so the main loop must call it often, and every message is delayed by up to
+ * a full loop period on top of the timeout. Here, every pin change arms a one-shot timer for the
+ * decoder's `nextDeadline()`, and its interruption handler ends the message as soon as it times out.
+ * The timeouts of the decoder are followed, whatever they are (See `WiegandTiming`).
+ *
+ * Any timer works, as long as it is wrapped in a class with these methods:
+ *
+ *     void start(unsigned long micros);   // (Re)starts the timer, to expire `micros` microseconds from now
+ *     void stop();                        // Stops the timer, if it is running
+ *
+ * When it expires, the timer handler must call `timerExpired()`. See the `timer_timeout` example.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <Wiegand.h>
+
+/**
+ * `Timer` is the one-shot timer, as described above.
+ * `Decoder` is the decoder being driven, `Wiegand` or a `StaticWiegand`.
+ *
+ * The timer interruption must not preempt the pin change interruption, or the other way around
+ * (On AVRs, interruption handlers don't nest, so nothing needs to be done)
+ */
+template<typename Timer, typename Decoder=Wiegand>
+class TimedWiegand : public Decoder {
+    Timer& timer;
+
+    /**
+     * Arms the timer for the deadline of the message being received, or stops it if there is none.
+     *
+     * Nothing else needs the timer: The settle time after a reader is connected ends on the next pin change.
+     */
+    void armTimer() {
+        unsigned long deadline;
+        if (!Decoder::nextDeadline(deadline)) {
+            timer.stop();
+            return;
+        }
+        //Unsigned, relative to the last pin change, so that it works across clock wraps
+        unsigned long timeout = deadline - Decoder::lastEventTime();
+        unsigned long elapsed = Decoder::time() - Decoder::lastEventTime();
+        unsigned long delay = elapsed < timeout ? timeout - elapsed : 1;
+        timer.start(Decoder::microseconds() ? delay : delay * 1000UL);
+    }
+
+public:
+    explicit TimedWiegand(Timer& timer) : Decoder(), timer(timer) {}
+
+    /**
+     * Same as the decoder's `end()`. Also stops the timer
+     */
+    void end() {
+        timer.stop();
+        Decoder::end();
+    }
+
+    /**
+     * Must be called by the timer interruption handler, when it expires.
+     *
+     * Sends out the pending message, if any, and resets state
+     */
+    inline void timerExpired() {
+        Decoder::flush();
+        //The timer may be a tick early, or the deadline may have moved
+        armTimer();
+    }
+
+    /**
+    * Updates the state of a pin, which changed at `timestamp` (in the decoder's time unit), and rearms the timer
+    *
+    * Pins that didn't change leave the timer alone
+    */
+    inline void setPinState(uint8_t pin, bool pin_state, unsigned long timestamp) {
+        if (Decoder::pinState(pin) != pin_state) {
+            Decoder::setPinState(pin, pin_state, timestamp);
+            armTimer();
+        }
+    }
+
+    /**
+    * Updates the state of a pin, and rearms the timer
+    *
+    * Pins that didn't change leave the timer alone
+    */
+    inline void setPinState(uint8_t pin, bool pin_state) {
+        if (Decoder::pinState(pin) != pin_state) {
+            Decoder::setPinState(pin, pin_state);
+            armTimer();
+        }
+    }
+
+    /**
+     * Notifies the library that the pin Data0 has changed to `pin_state`
+     */
+    inline void setPin0State(bool state) {
+      setPinState(0, state);
+    }
+
+    /**
+     * Notifies the library that the pin Data1 has changed to `pin_state`
+     */
+    inline void setPin1State(bool state) {
+      setPinState(1, state);
+    }
+};
@@ -1,57 +1,75 @@
 #include <Wiegand.h>
+#include <WiegandCore.h>
+#include <WiegandTiming.h>
 #include <Arduino.h>
 
-#define PIN_0                        0x01
-#define PIN_1                        0x02
-#define DEVICE_CONNECTED             0x04
-#define DEVICE_INITIALIZED           0x08
+using namespace WiegandCore;
 
-#define ERROR_TRANSMISSION           0x10
-#define ERROR_TOO_BIG                0x20
+Wiegand::time_source Wiegand::clock = nullptr;
+Wiegand::time_source Wiegand::micros_clock = nullptr;
 
-#define MASK_PINS                    (PIN_0 | PIN_1)
-#define MASK_STATE                   0x0F
-#define MASK_ERRORS                  0xF0
+/**
+ * Current time in milliseconds, according to the time source
+ */
+unsigned long Wiegand::now() {
+    return clock ? clock() : millis();
+}
 
 /**
- * Sets the value of the `i`-th data bit
+ * Current time in microseconds, according to the microseconds time source
  */
-inline void writeBit(uint8_t* data, uint8_t i, bool value) {
-    if (value) {
-        data[i>>3] |=  (0x80 >> (i&7));
-    } else {
-        data[i>>3] &= ~(0x80 >> (i&7));
-    }
+unsigned long Wiegand::nowMicros() {
+    return micros_clock ? micros_clock() : micros();
+}
+
+Wiegand::Wiegand() :
+    expected_bits(0), decode_messages(false), bits(0), state(0), timestamp(0), accumulator(0), timing(nullptr),
+    func_data(nullptr), func_data_error(nullptr), func_state(nullptr), func_credential(nullptr), func_deadline(nullptr),
+    func_data_param(nullptr), func_data_error_param(nullptr), func_state_param(nullptr), func_credential_param(nullptr),
+    func_deadline_param(nullptr)
+{
+    memset(data, 0, sizeof(data));
 }
 
 /**
- * Reads the value of the `i`-th data bit
+ * Current time for this instance: `now()`, or `nowMicros()` when its timing is in microseconds
  */
-inline bool readBit(uint8_t* data, uint8_t i) {
-    return bool(data[i>>3] & (0x80 >> (i&7)));
+unsigned long Wiegand::time() {
+    return microseconds() ? nowMicros() : now();
 }
 
 /**
- * Sign a subrange of data, shrinks and aligns the buffer to the right, inline
- *
- * returns the number of bits in the subrange
+ * Tells if time is in microseconds for this instance
  */
-inline uint8_t align_data(uint8_t* data, uint8_t start, uint8_t end) {
-    uint8_t aligned_data[Wiegand::MAX_BYTES];
-    uint8_t aligned_bits = end - start;
-    uint8_t aligned_bytes = (aligned_bits + 7)/8;
-    uint8_t aligned_offset = 8*aligned_bytes - aligned_bits;
-
-    aligned_data[0] = 0;
-    for (int bit=0; bit<aligned_bits; bit++) {
-        writeBit(aligned_data, bit + aligned_offset, readBit(data, bit+start));
-    }
-    for (int i=0; i<aligned_bytes; i++) {
-        data[i] = aligned_data[i];
+bool Wiegand::microseconds() {
+    return timing && timing->microseconds;
+}
+
+/**
+ * Attaches the timing of this instance, replacing the fixed `TIMEOUT`
+ */
+void Wiegand::setTiming(WiegandTiming* timing) {
+    this->timing = timing;
+}
+
+/**
+ * Quiet time that ends the message being received, or the settle time if there is none
+ */
+unsigned long Wiegand::quietTime() {
+    if (!timing) {
+        return TIMEOUT;
     }
-    return aligned_bits;
+    //A message being received may end sooner, see `WiegandTiming::setAdaptiveTimeout()`
+    return bits ? timing->frame_timeout : timing->settle_time;
 }
 
+/**
+ * Tells when the message being received times out, i.e., the first time at which `flush()` would send it out.
+ */
+bool Wiegand::nextDeadline(unsigned long& deadline) {
+    deadline = timestamp + quietTime() + 1;
+    return bits > 0;
+}
 
 /**
  * Sets the device as "initialized" and resets it to wait a new message.
@@ -73,7 +91,7 @@ void Wiegand::begin(uint8_t expected_bits, bool decode_messages) {
 
     //Set state as "INVALID", so that data can only be received after a few millis in "ready" state
     bits=0;
-    timestamp = millis();
+    timestamp = time();
     state = (state & MASK_STATE) | DEVICE_INITIALIZED | ERROR_TRANSMISSION;
 }
 
@@ -84,7 +102,7 @@ void Wiegand::end() {
     expected_bits = 0;
 
     bits=0;
-    timestamp = millis();
+    timestamp = time();
     state &= MASK_STATE & ~DEVICE_INITIALIZED;
 }
 
@@ -96,12 +114,17 @@ void Wiegand::end() {
  * to signal it is probably in the middle of a truncated message or something.
  */
 void Wiegand::reset() {
-    bits=0;
-    state &= MASK_STATE;
-    //A transmission must start with D0=1, D1=1
-    if ((state & MASK_PINS) != MASK_PINS) {
-        state |= ERROR_TRANSMISSION;
-    }
+    resetMessage(state, bits);
+}
+
+
+/**
+ * Marks the message being received as corrupted, e.g., because some of its events were lost.
+ *
+ * It will be reported as a `Communication` error.
+ */
+void Wiegand::messageCorrupted() {
+    state |= ERROR_TRANSMISSION;
 }
 
 
@@ -121,93 +144,31 @@ Wiegand::operator bool() {
  * If the buffer is invalid, it is discarded
  */
 void Wiegand::flushData() {
-    //Ignore empty messages
-    if ((bits == 0) || (expected_bits == 0)) {
-        return;
-    }
-
-    //Check for pending errors
-    if (state & MASK_ERRORS) {
-        if (func_data_error) {
-            bits = align_data(data, 0, bits);
-            if (state & ERROR_TOO_BIG) {
-                func_data_error(DataError::SizeTooBig, data, bits, func_data_error_param);
-            } else {
-                func_data_error(DataError::Communication, data, bits, func_data_error_param);
-            }
-        }
-        return;
-    }
-
-    //Validate the message size
-    if ((expected_bits != bits) && (expected_bits != Wiegand::LENGTH_ANY)) {
-        if (func_data_error) {
-            bits = align_data(data, 0, bits);
-            func_data_error(DataError::SizeUnexpected, data, bits, func_data_error_param);
-        }
-        return;
-    }
-
-    //Decode the message
-    if (!decode_messages) {
-        if (func_data) {
-            bits = align_data(data, 0, bits);
-            func_data(data, bits, func_data_param);
-        }
-    } else {
-        //4-bit keycode: No check necessary
-        if ((bits == 4)) {
+    DataError error;
+    WiegandCredential credential;
+    switch (decodeMessage(state, expected_bits, decode_messages, data, bits, accumulator, error, func_credential ? &credential : nullptr)) {
+        case Received:
             if (func_data) {
-                bits = align_data(data, 0, bits);
                 func_data(data, bits, func_data_param);
             }
-
-        //8-bit keybode: UpperNibble = ~lowerNibble
-        } else if ((bits == 8)) {
-            uint8_t value = data[0] & 0xF;
-            if (data[0] == (value | ((0xF & ~value)<<4))) {
-                if (func_data) {
-                    func_data(&value, 4, func_data_param);
-                }
-            } else {
-                if (func_data_error) {
-                    bits = align_data(data, 0, bits);
-                    func_data_error(DataError::VerificationFailed, data, bits, func_data_error_param);
-                }
+            if (func_credential && credential.format != WiegandFormat::Unknown) {
+                func_credential(credential, func_credential_param);
             }
-
-        //26 or 34-bits: First and last bits are used for parity
-        } else if ((bits == 26) || (bits == 34)) {
-            //FIXME: The parity check doesn't seem to work for a 34-bit reader I have,
-            //but I suspect that the reader is non-complaint
-
-            boolean left_parity = false;
-            boolean right_parity = false;
-            for (int i=0; i<(bits+1)/2; i++) {
-                left_parity = (left_parity != readBit(data, i));
-            }
-            for (int i=bits/2; i<bits; i++) {
-                right_parity = (right_parity != readBit(data, i));
-            }
-
-            if (!left_parity && right_parity) {
-                if (func_data) {
-                    bits = align_data(data, 1, bits-1);
-                    func_data(data, bits, func_data_param);
-                }
-            } else {
-                if (func_data_error) {
-                    bits = align_data(data, 0, bits);
-                    func_data_error(DataError::VerificationFailed, data, bits, func_data_error_param);
-                }
+            break;
+        case Failed:
+            //Rejected pulses are the likely cause, and are reported along with the message
+            if (timing && timing->message_rejected) {
+                error = PulseRejected;
             }
-
-        } else {
             if (func_data_error) {
-                bits = align_data(data, 0, bits);
-                func_data_error(DataError::DecodeFailed, data, bits, func_data_error_param);
+                func_data_error(error, data, bits, func_data_error_param);
             }
-        }
+            break;
+        case NoMessage:
+            break;
+    }
+    if (timing) {
+        timing->message_rejected = false;
     }
 }
 
@@ -218,9 +179,18 @@ void Wiegand::flushData() {
  * This means sending out any pending message and calling `reset()`
  */
 void Wiegand::flush() {
-    unsigned long elapsed = millis() - timestamp;
+    flush(time());
+}
+
+/**
+ * Same as `flush()`, but with the current time provided by the caller.
+ *
+ * `now` must not be older than the last event
+ */
+void Wiegand::flush(unsigned long now) {
     // Resets state if nothing happened in a few milliseconds
-    if (elapsed > TIMEOUT) {
+    //Unsigned, so that it still works after an idle time of over half the clock range (35 minutes, for a 32-bit `micros()`)
+    if (now - timestamp > quietTime()) {
         // Might have a pending data package
         flushData();
         reset();
@@ -236,23 +206,31 @@ void Wiegand::flushNow() {
 }
 
 /**
- * Adds a new bit to the payload
+ * Adds a new bit to the payload, received at `timestamp`
  */
-void Wiegand::addBitInternal(bool value) {
-    //Skip if we have too much data
-    if (bits >= MAX_BITS) {
-        state |= ERROR_TOO_BIG;
-    } else {
-        writeBit(data, bits++, value);
+void Wiegand::addBitInternal(bool value, unsigned long timestamp) {
+    if (timing && !timing->bitReceived(bits, timestamp)) {
+        //Transmission stalled
+        messageCorrupted();
     }
 
+    addBit(state, bits, accumulator, data, value);
+
     // If we know the number of bits, there is no need to wait for the timeout to send the data
     if (expected_bits > 0 && (bits == expected_bits)) {
         flushData();
         reset();
+    } else if (func_deadline) {
+        func_deadline(this, func_deadline_param);
     }
 }
 
+/**
+ * Level of a pin, as last reported
+ */
+bool Wiegand::pinState(uint8_t pin) {
+    return !pinUnchanged(state, pin, false);
+}
 
 /**
  * Updates the state of a pin.
@@ -261,48 +239,60 @@ void Wiegand::addBitInternal(bool value) {
  * dispatching the payload to the callback, etc
  */
 void Wiegand::setPinState(uint8_t pin, bool pin_state) {
-    uint8_t pin_mask = pin ? PIN_1 : PIN_0;
-
-    flush();
+    //Only read the clock for actual changes
+    if (pinUnchanged(state, pin, pin_state)) {
+        return;
+    }
+    setPinState(pin, pin_state, time());
+}
 
+/**
+ * Same as `setPinState()`, for a pin change that happened at `timestamp` milliseconds
+ */
+void Wiegand::setPinState(uint8_t pin, bool pin_state, unsigned long timestamp) {
     //No change? Abort!
-    if (bool(state & pin_mask) == pin_state) {
+    if (pinUnchanged(state, pin, pin_state)) {
         return;
     }
 
-    timestamp = millis();
-    if (pin_state) {
-        state |= pin_mask;
-    } else {
-        state &= ~pin_mask;
+    //The gap since the previous change tells if the pending message (or the settle time) is over, as `flush()` would
+    if (timestamp - this->timestamp > quietTime()) {
+        flushData();
+        reset();
     }
+    this->timestamp = timestamp;
+    //A pin going low starts a pulse
+    if (timing && !pin_state) {
+        timing->pulse_start = timestamp;
+    }
+
+    switch (updatePin(state, pin, pin_state)) {
+        case BitReceived:
+            if (!timing || timing->pulseAccepted(bits, timestamp)) {
+                addBitInternal(pin, timestamp);
+            }
+            break;
 
-    //Both pins on: bit received
-    if ((state & MASK_PINS) == MASK_PINS) {
-        //If the device wasn't ready before -- Enable it, and marks state as INVALID until is settles.
-        if (state & DEVICE_CONNECTED) {
-            addBitInternal(pin);
-        } else {
-            //Device connection was detected right now!
-            //Set the device as connected, but unstable
-            state = (state & MASK_STATE) | DEVICE_CONNECTED | ERROR_TRANSMISSION;
+        case DeviceConnected:
             if (func_state) {
                 func_state(true, func_state_param);
             }
-        }
+            break;
 
-    //Both pins off - Device is unplugged
-    } else if ((state & MASK_PINS) == 0) {
-        if (state & DEVICE_CONNECTED) {
+        case DeviceDisconnected:
             //Flush truncated message, if any, and resets state
-            state |= ERROR_TRANSMISSION;
             flushNow();
-
-            //Set the state as disconnected
-            state = (state & MASK_STATE & ~DEVICE_CONNECTED);
+            setDisconnected(state);
+            //The next reader may be a different model
+            if (timing) {
+                timing->forget();
+            }
             if (func_state) {
                 func_state(false, func_state_param);
             }
-        }
+            break;
+
+        default:
+            break;
     }
 }
@@ -1,4 +1,23 @@
+#pragma once
+
 #include <stdint.h>
+#include <WiegandFormats.h>
+
+class WiegandTiming;
+
+/**
+ * Width of the shift register where incoming bits are accumulated.
+ *
+ * Messages longer than this are spilled into the byte buffer as they arrive.
+ * 64-bit shifts are expensive on 8-bit AVRs, so they default to a 32-bit accumulator.
+ */
+#ifndef WIEGAND_ACCUMULATOR_BITS
+#  ifdef __AVR__
+#    define WIEGAND_ACCUMULATOR_BITS 32
+#  else
+#    define WIEGAND_ACCUMULATOR_BITS 64
+#  endif
+#endif
 
 class Wiegand {
 public:
@@ -29,7 +48,7 @@ public:
     /**
      * Possible communication errors sent to your `data_error_callback`
      */
-    enum DataError { Communication, SizeTooBig, SizeUnexpected, DecodeFailed, VerificationFailed};
+    enum DataError { Communication, SizeTooBig, SizeUnexpected, DecodeFailed, VerificationFailed, PulseRejected};
 
     /**
      * Gets the message associated with a `DataError`
@@ -46,14 +65,36 @@ public:
                 return "Unsupported message format";
             case VerificationFailed:
                 return "Message verification failed";
+            case PulseRejected:
+                return "Pulse rejected";
             default:
                 return "Unknown";
         }
     }
 
+#if WIEGAND_ACCUMULATOR_BITS == 64
+    typedef uint64_t accumulator_t;
+#elif WIEGAND_ACCUMULATOR_BITS == 32
+    typedef uint32_t accumulator_t;
+#else
+#   error WIEGAND_ACCUMULATOR_BITS must be 32 or 64
+#endif
+
+    /**
+     * Number of bits held by the accumulator
+     */
+    static const uint8_t ACCUMULATOR_BITS = WIEGAND_ACCUMULATOR_BITS;
+
+    /**
+     * A function returning the current time in milliseconds, like `millis()` (or in microseconds, like `micros()`, see `setMicrosSource()`)
+     */
+    typedef unsigned long (*time_source)();
+
     typedef void (*data_callback)(uint8_t* data, uint8_t bits, void* param);
     typedef void (*data_error_callback)(DataError error, uint8_t* rawdata, uint8_t bits, void* param);
     typedef void (*state_callback)(bool plugged, void* param);
+    typedef void (*credential_callback)(const WiegandCredential& credential, void* param);
+    typedef void (*deadline_callback)(Wiegand* wiegand, void* param);
 
 private:
     uint8_t expected_bits;
@@ -61,18 +102,29 @@ private:
     uint8_t bits;
     uint8_t state;
     unsigned long timestamp;
+    accumulator_t accumulator;
     uint8_t data[MAX_BYTES];
+    WiegandTiming* timing;
     Wiegand::data_callback func_data;
     Wiegand::data_error_callback func_data_error;
     Wiegand::state_callback func_state;
+    Wiegand::credential_callback func_credential;
+    Wiegand::deadline_callback func_deadline;
     void* func_data_param;
     void* func_data_error_param;
     void* func_state_param;
+    void* func_credential_param;
+    void* func_deadline_param;
 
     /**
-     * Adds a new bit to the payload
+     * Adds a new bit to the payload, received at `timestamp`
      */
-    void addBitInternal(bool value);
+    void addBitInternal(bool value, unsigned long timestamp);
+
+    /**
+     * Quiet time that ends the message being received, or the settle time if there is none
+     */
+    unsigned long quietTime();
 
     /**
      * Verifies if the current buffer is valid and sends it to the data / error callbacks.
@@ -80,7 +132,27 @@ private:
      */
     void flushData();
 
+    /**
+     * Function used to read the current time, see `setTimeSource()`
+     */
+    static time_source clock;
+
+    /**
+     * Function used to read the current time in microseconds, see `setMicrosSource()`
+     */
+    static time_source micros_clock;
+
+protected:
+    /**
+     * Marks the message being received as corrupted, e.g., because some of its events were lost.
+     *
+     * It will be reported as a `Communication` error.
+     */
+    void messageCorrupted();
+
 public:
+    Wiegand();
+
     /**
     * Sets the device as "initialized" and resets it to wait a new message.
     *
@@ -119,17 +191,54 @@ public:
     operator bool();
 
     /**
-     * Clean up state after `WIEGAND_TIMEOUT` milliseconds without events
+     * Time (in milliseconds, or microseconds, see `setTiming()`) of the last pin change.
+     *
+     * Inside a data callback, this is when the last bit of the message was received.
+     */
+    inline unsigned long lastEventTime() {
+        return timestamp;
+    }
+
+    /**
+     * Level of a pin, as last reported with `setPinState()`
+     */
+    bool pinState(uint8_t pin);
+
+    /**
+     * Clean up state after `TIMEOUT` milliseconds without events (or the timeouts set with `setTiming()`)
      *
      * This means sending out any pending message and calling `reset()`
      */
     void flush();
 
+    /**
+     * Same as `flush()`, but with the current time provided by the caller.
+     *
+     * `now` must not be older than the last event
+     */
+    void flush(unsigned long now);
+
     /**
     * Immediately cleans up state, sending out pending messages and calling `reset()`
     */
     void flushNow();
 
+    /**
+     * Attaches the timing of this instance, replacing the fixed `TIMEOUT`. See `WiegandTiming`.
+     *
+     * Each instance needs its own. `nullptr` goes back to `TIMEOUT`. It must be set before `begin()`.
+     */
+    void setTiming(WiegandTiming* timing);
+
+    /**
+     * Current time for this instance: `now()`, or `nowMicros()` when its timing is in microseconds
+     */
+    unsigned long time();
+
+    /**
+     * Tells if `time()`, timestamps and deadlines of this instance are in microseconds, see `WiegandTiming::setTimeouts()`
+     */
+    bool microseconds();
 
     /**
      * Attaches a Data Receive Callback.
@@ -152,6 +261,38 @@ public:
       func_data_error_param = (void*)param;
     }
 
+    /**
+     * Attaches a Credential Callback.
+     *
+     * This will be called right after the data callback for messages of a known card format (See `WiegandFormats`),
+     * with its format, facility code and card number already extracted.
+     * Messages are only decoded with `decode_messages=true`.
+     */
+    template<typename T> void onCredential(void (*func)(const WiegandCredential& credential, T* param), T* param=nullptr) {
+      func_credential = (credential_callback)func;
+      func_credential_param = (void*)param;
+    }
+
+    /**
+     * Attaches a Deadline Callback, used to schedule `flush()` calls (See `WiegandScheduler`).
+     *
+     * This will be called whenever a bit is received on a message that isn't complete yet,
+     * since its deadline (see `nextDeadline()`) may have changed.
+     */
+    template<typename T> void onDeadline(void (*func)(Wiegand* wiegand, T* param), T* param=nullptr) {
+      func_deadline = (deadline_callback)func;
+      func_deadline_param = (void*)param;
+    }
+
+    /**
+     * Tells when the message being received times out, i.e., the first time at which `flush()` would send it out.
+     *
+     * Returns false if there is no message being received, in which case `flush()` has nothing to do:
+     * Nothing can happen until the next pin change, and the main loop may sleep until then.
+     * That includes the settle time after a reader is connected, which the next pin change ends on its own.
+     */
+    bool nextDeadline(unsigned long& deadline);
+
     /**
      * Attaches a State Change Callback. This is called whenever a device is attached or dettached.
      *
@@ -171,6 +312,43 @@ public:
     */
     void setPinState(uint8_t pin, bool pin_state);
 
+    /**
+    * Updates the state of a pin, which changed at `timestamp` milliseconds (or microseconds, see `setTiming()`).
+    *
+    * Use it if the interruption handler already captured the time of the change,
+    * or to replay recorded pin changes.
+    */
+    void setPinState(uint8_t pin, bool pin_state, unsigned long timestamp);
+
+    /**
+     * Replaces the time source used by all instances when a timestamp isn't provided.
+     *
+     * `nullptr` restores the default, `millis()`
+     */
+    static inline void setTimeSource(time_source source) {
+        clock = source;
+    }
+
+    /**
+     * Current time in milliseconds, according to the time source
+     */
+    static unsigned long now();
+
+    /**
+     * Replaces the time source used by instances with timings in microseconds (See `WiegandTiming::setTimeouts()`)
+     * when a timestamp isn't provided.
+     *
+     * `nullptr` restores the default, `micros()`
+     */
+    static inline void setMicrosSource(time_source source) {
+        micros_clock = source;
+    }
+
+    /**
+     * Current time in microseconds, according to the microseconds time source
+     */
+    static unsigned long nowMicros();
+
     /**
      * Notifies the library that the pin Data0 has changed to `pin_state`
      */
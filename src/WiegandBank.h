@@ -0,0 +1,311 @@
+/*
+ * Handles many Wiegand readers in a single object.
+ *
+ * All channels share the same configuration and callbacks, and per-channel state is kept in
+ * packed arrays (struct-of-arrays), which takes much less RAM than one `Wiegand` per reader.
+ *
+ * Timeouts of all channels are handled by a single call to `flush()`, which only
+ * looks at channels that had some activity since they were last flushed.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <Wiegand.h>
+#include <WiegandCore.h>
+
+/**
+ * `CHANNELS` is the number of readers, up to 32.
+ *
+ * `MAX_BITS` and `bits_t` size the per-channel buffer and bit counter, like on `StaticWiegand`
+ */
+template<uint8_t CHANNELS, uint16_t MAX_BITS=Wiegand::MAX_BITS, typename bits_t=uint8_t>
+class WiegandBank {
+    static_assert(CHANNELS > 0 && CHANNELS <= 32, "WiegandBank supports up to 32 channels");
+    static_assert(MAX_BITS > 0 && MAX_BITS < bits_t(~bits_t(0)), "bits_t is too small for MAX_BITS");
+
+public:
+    static const uint16_t MAX_BYTES = (MAX_BITS + 7) / 8;
+
+    typedef void (*data_callback)(uint8_t channel, uint8_t* data, bits_t bits, void* param);
+    typedef void (*data_error_callback)(uint8_t channel, Wiegand::DataError error, uint8_t* rawdata, bits_t bits, void* param);
+    typedef void (*state_callback)(uint8_t channel, bool plugged, void* param);
+    typedef void (*credential_callback)(uint8_t channel, const WiegandCredential& credential, void* param);
+
+protected:
+    bits_t expected_bits;
+    bool decode_messages;
+
+    /**
+     * Channels that had activity since they were last flushed, one bit per channel
+     */
+    uint32_t active;
+
+    uint8_t state[CHANNELS];
+    bits_t bits[CHANNELS];
+    unsigned long timestamp[CHANNELS];
+    Wiegand::accumulator_t accumulator[CHANNELS];
+    uint8_t data[CHANNELS][MAX_BYTES];
+
+    data_callback func_data;
+    data_error_callback func_data_error;
+    state_callback func_state;
+    credential_callback func_credential;
+    void* func_data_param;
+    void* func_data_error_param;
+    void* func_state_param;
+    void* func_credential_param;
+
+    /**
+     * Verifies if the buffer of `channel` is valid and sends it to the data / error callbacks,
+     * then resets it to wait a new message.
+     */
+    void flushChannel(uint8_t channel) {
+        using namespace WiegandCore;
+        Wiegand::DataError error;
+        WiegandCredential credential;
+        switch (decodeMessage<MAX_BITS>(state[channel], expected_bits, decode_messages, data[channel], bits[channel], accumulator[channel], error, func_credential ? &credential : nullptr)) {
+            case Received:
+                if (func_data) {
+                    func_data(channel, data[channel], bits[channel], func_data_param);
+                }
+                if (func_credential && credential.format != WiegandFormat::Unknown) {
+                    func_credential(channel, credential, func_credential_param);
+                }
+                break;
+            case Failed:
+                if (func_data_error) {
+                    func_data_error(channel, error, data[channel], bits[channel], func_data_error_param);
+                }
+                break;
+            case NoMessage:
+                break;
+        }
+        resetMessage(state[channel], bits[channel]);
+    }
+
+    /**
+     * Flushes `channel` if it has been idle for longer than `Wiegand::TIMEOUT` at `timestamp`
+     */
+    inline void timeoutChannel(uint8_t channel, unsigned long timestamp) {
+        if ((active & (1UL << channel)) && timestamp - this->timestamp[channel] > Wiegand::TIMEOUT) {
+            flushChannel(channel);
+        }
+    }
+
+    /**
+     * Acts on a pin change of `channel`, already applied to its state by `WiegandCore::updatePin()`
+     */
+    void handleEvent(uint8_t channel, WiegandCore::PinEvent event, uint8_t pin, unsigned long timestamp) {
+        using namespace WiegandCore;
+
+        if (event == PinUnchanged) {
+            return;
+        }
+        this->timestamp[channel] = timestamp;
+        active |= 1UL << channel;
+
+        switch (event) {
+            case BitReceived:
+                addBit<MAX_BITS>(state[channel], bits[channel], accumulator[channel], data[channel], pin);
+                // If we know the number of bits, there is no need to wait for the timeout to send the data
+                if (expected_bits != Wiegand::LENGTH_ANY && bits[channel] == expected_bits) {
+                    flushChannel(channel);
+                }
+                break;
+
+            case DeviceConnected:
+                if (func_state) {
+                    func_state(channel, true, func_state_param);
+                }
+                break;
+
+            case DeviceDisconnected:
+                //Flush truncated message, if any, and resets state
+                flushChannel(channel);
+                setDisconnected(state[channel]);
+                if (func_state) {
+                    func_state(channel, false, func_state_param);
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+public:
+    WiegandBank() :
+        expected_bits(0), decode_messages(false), active(0),
+        func_data(nullptr), func_data_error(nullptr), func_state(nullptr), func_credential(nullptr),
+        func_data_param(nullptr), func_data_error_param(nullptr), func_state_param(nullptr), func_credential_param(nullptr)
+    {
+        for (uint8_t channel=0; channel<CHANNELS; channel++) {
+            state[channel] = 0;
+            bits[channel] = 0;
+            timestamp[channel] = 0;
+            accumulator[channel] = 0;
+        }
+        memset(data, 0, sizeof(data));
+    }
+
+    /**
+     * Sets all channels as "initialized" and resets them to wait a new message.
+     *
+     * `expected_bits` and `decode_messages` work the same as on `Wiegand::begin()`
+     */
+    void begin(bits_t expected_bits=Wiegand::LENGTH_ANY, bool decode_messages=true) {
+        using namespace WiegandCore;
+        this->expected_bits = expected_bits;
+        this->decode_messages = decode_messages;
+
+        //Set state as "INVALID", so that data can only be received after a few millis in "ready" state
+        unsigned long now = Wiegand::now();
+        for (uint8_t channel=0; channel<CHANNELS; channel++) {
+            bits[channel] = 0;
+            timestamp[channel] = now;
+            state[channel] = (state[channel] & MASK_STATE) | DEVICE_INITIALIZED | ERROR_TRANSMISSION;
+        }
+        active = CHANNELS == 32 ? 0xFFFFFFFFUL : (1UL << CHANNELS) - 1;
+    }
+
+    /**
+     * Sets all channels as "not-initialized"
+     */
+    void end() {
+        using namespace WiegandCore;
+        expected_bits = 0;
+        for (uint8_t channel=0; channel<CHANNELS; channel++) {
+            bits[channel] = 0;
+            state[channel] &= MASK_STATE & ~DEVICE_INITIALIZED;
+        }
+        active = 0;
+    }
+
+    /**
+     * Returns if the bank is initialized (with `begin()`) and a reader has been connected to `channel`.
+     */
+    bool connected(uint8_t channel) {
+        using namespace WiegandCore;
+        return (state[channel] & (DEVICE_CONNECTED|DEVICE_INITIALIZED)) == (DEVICE_CONNECTED|DEVICE_INITIALIZED);
+    }
+
+    /**
+     * Cleans up channels after `Wiegand::TIMEOUT` milliseconds without events, sending out pending messages.
+     *
+     * `now` must not be older than the last event
+     */
+    void flush(unsigned long now) {
+        uint32_t remaining = active;
+        for (uint8_t channel=0; remaining; channel++, remaining >>= 1) {
+            if ((remaining & 1) && now - timestamp[channel] > Wiegand::TIMEOUT) {
+                flushChannel(channel);
+                active &= ~(1UL << channel);
+            }
+        }
+    }
+
+    /**
+     * Tells when the first message being received times out, i.e., the first time at which `flush()` would send it out.
+     *
+     * Returns false if no channel is receiving a message: Nothing can happen until the next pin change.
+     * That includes the settle time after a reader is connected, which the next pin change of that channel ends on its own.
+     */
+    bool nextDeadline(unsigned long& deadline) {
+        bool pending = false;
+        for (uint8_t channel=0; channel<CHANNELS; channel++) {
+            unsigned long channel_deadline = timestamp[channel] + Wiegand::TIMEOUT + 1;
+            if (bits[channel] > 0 && (!pending || long(channel_deadline - deadline) < 0)) {
+                deadline = channel_deadline;
+                pending = true;
+            }
+        }
+        return pending;
+    }
+
+    /**
+     * Cleans up channels after `Wiegand::TIMEOUT` milliseconds without events, sending out pending messages.
+     *
+     * Like `Wiegand::flush()`, call it from your main loop, with interruptions disabled.
+     */
+    inline void flush() {
+        flush(Wiegand::now());
+    }
+
+    /**
+     * Immediately cleans up `channel`, sending out its pending message
+     */
+    void flushNow(uint8_t channel) {
+        flushChannel(channel);
+    }
+
+    /**
+     * Updates the state of a pin of `channel`, which changed at `timestamp` milliseconds
+     */
+    void setPinState(uint8_t channel, uint8_t pin, bool pin_state, unsigned long timestamp) {
+        //No change? Abort!
+        if (WiegandCore::pinUnchanged(state[channel], pin, pin_state)) {
+            return;
+        }
+        timeoutChannel(channel, timestamp);
+        handleEvent(channel, WiegandCore::updatePin(state[channel], pin, pin_state), pin, timestamp);
+    }
+
+    /**
+     * Updates the state of a pin of `channel`.
+     *
+     * It will trigger adding bits to the payload, device connection/disconnection,
+     * dispatching the payload to the callback, etc
+     */
+    inline void setPinState(uint8_t channel, uint8_t pin, bool pin_state) {
+        //Only read the clock for actual changes
+        if (!WiegandCore::pinUnchanged(state[channel], pin, pin_state)) {
+            setPinState(channel, pin, pin_state, Wiegand::now());
+        }
+    }
+
+    /**
+     * Notifies the library that the pin Data0 of `channel` has changed to `pin_state`
+     */
+    inline void setPin0State(uint8_t channel, bool pin_state) {
+        setPinState(channel, 0, pin_state);
+    }
+
+    /**
+     * Notifies the library that the pin Data1 of `channel` has changed to `pin_state`
+     */
+    inline void setPin1State(uint8_t channel, bool pin_state) {
+        setPinState(channel, 1, pin_state);
+    }
+
+    /**
+     * Attaches a Data Receive Callback, shared by all channels.
+     */
+    template<typename T> void onReceive(void (*func)(uint8_t channel, uint8_t* data, bits_t bits, T* param), T* param=nullptr) {
+        func_data = (data_callback)func;
+        func_data_param = (void*)param;
+    }
+
+    /**
+     * Attaches a Data Transmission Error Callback, shared by all channels.
+     */
+    template<typename T> void onReceiveError(void (*func)(uint8_t channel, Wiegand::DataError error, uint8_t* data, bits_t bits, T* param), T* param=nullptr) {
+        func_data_error = (data_error_callback)func;
+        func_data_error_param = (void*)param;
+    }
+
+    /**
+     * Attaches a Credential Callback, shared by all channels.
+     */
+    template<typename T> void onCredential(void (*func)(uint8_t channel, const WiegandCredential& credential, T* param), T* param=nullptr) {
+        func_credential = (credential_callback)func;
+        func_credential_param = (void*)param;
+    }
+
+    /**
+     * Attaches a State Change Callback, shared by all channels.
+     */
+    template<typename T> void onStateChange(void (*func)(uint8_t channel, bool plugged, T* param), T* param=nullptr) {
+        func_state = (state_callback)func;
+        func_state_param = (void*)param;
+    }
+};
@@ -0,0 +1,71 @@
+/*
+ * Bit manipulation helpers used internally by the Wiegand decoder.
+ *
+ * Bits are stored MSB-first: bit 0 is the most significant bit of the first byte.
+ */
+#pragma once
+
+#include <Wiegand.h>
+#include <string.h>
+
+/**
+ * Sets the value of the `i`-th data bit
+ */
+inline void writeBit(uint8_t* data, uint16_t i, bool value) {
+    if (value) {
+        data[i>>3] |=  (0x80 >> (i&7));
+    } else {
+        data[i>>3] &= ~(0x80 >> (i&7));
+    }
+}
+
+/**
+ * Reads the value of the `i`-th data bit
+ */
+inline bool readBit(uint8_t* data, uint16_t i) {
+    return bool(data[i>>3] & (0x80 >> (i&7)));
+}
+
+/**
+ * Sign a subrange of data, shrinks and aligns the buffer to the right, inline
+ *
+ * Works a byte at a time: each output byte is assembled from the (at most) 2 input bytes it overlaps.
+ *
+ * returns the number of bits in the subrange
+ */
+inline uint16_t align_data(uint8_t* data, uint16_t start, uint16_t end) {
+    uint16_t aligned_bits = end - start;
+    uint16_t aligned_bytes = (aligned_bits + 7)/8;
+    uint8_t aligned_offset = 8*aligned_bytes - aligned_bits;
+
+    if (aligned_bytes == 0) {
+        return 0;
+    }
+
+    if (start >= aligned_offset) {
+        // Shifting to the left: Output byte `i` only needs input bytes `>= i`, walk forward
+        uint16_t shift = start - aligned_offset;
+        uint16_t src = shift >> 3;
+        uint8_t bit_shift = shift & 7;
+        uint16_t src_bytes = (end + 7)/8;
+        if (bit_shift == 0) {
+            memmove(data, data + src, aligned_bytes);
+        } else {
+            for (uint16_t i=0; i<aligned_bytes; i++, src++) {
+                uint8_t lo = (src + 1 < src_bytes) ? data[src + 1] : 0;
+                data[i] = (data[src] << bit_shift) | (lo >> (8 - bit_shift));
+            }
+        }
+    } else {
+        // Shifting to the right (by less than a byte): Output byte `i` needs input bytes `i-1` and `i`, walk backwards
+        uint8_t bit_shift = aligned_offset - start;
+        for (uint16_t i=aligned_bytes-1; i>0; i--) {
+            data[i] = (data[i-1] << (8 - bit_shift)) | (data[i] >> bit_shift);
+        }
+        data[0] >>= bit_shift;
+    }
+
+    // Clear the padding
+    data[0] &= 0xFF >> aligned_offset;
+    return aligned_bits;
+}
@@ -0,0 +1,401 @@
+/*
+ * Wiegand protocol state machine and message decoding, shared by all decoder front-ends.
+ *
+ * These functions work on the individual fields of a channel (pin / error flags, bit count,
+ * accumulator, ...) instead of on an object, so that the same logic serves a single `Wiegand`
+ * instance as well as the packed arrays of a `WiegandBank`.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <Wiegand.h>
+#include <WiegandBits.h>
+#include <WiegandFormats.h>
+
+/**
+ * Set to 1 to decode pin changes with a transition table instead of branches, see `WiegandCore::updatePinTable()`
+ */
+#ifndef WIEGAND_TRANSITION_TABLE
+#  define WIEGAND_TRANSITION_TABLE 0
+#endif
+
+namespace WiegandCore {
+    /**
+     * Flags in the `state` byte of a channel
+     */
+    static const uint8_t PIN_0              = 0x01;
+    static const uint8_t PIN_1              = 0x02;
+    static const uint8_t DEVICE_CONNECTED   = 0x04;
+    static const uint8_t DEVICE_INITIALIZED = 0x08;
+
+    static const uint8_t ERROR_TRANSMISSION = 0x10;
+    static const uint8_t ERROR_TOO_BIG      = 0x20;
+
+    /**
+     * Configuration, for front-ends that keep it in the state byte (See `CompactWiegand`)
+     */
+    static const uint8_t DECODE_MESSAGES    = 0x40;
+
+    static const uint8_t MASK_PINS          = PIN_0 | PIN_1;
+    static const uint8_t MASK_STATE         = 0xCF;
+    static const uint8_t MASK_ERRORS        = 0x30;
+
+    /**
+     * What a pin change means for the channel
+     */
+    enum PinEvent {
+        PinUnchanged,       // Pin was already on this level: Nothing to do
+        PinChanged,         // Pin has changed, nothing else happened
+        BitReceived,        // Both pins went high while connected: The pin that went high is the bit value
+        DeviceConnected,    // Both pins went high while disconnected
+        DeviceDisconnected  // Both pins went low while connected
+    };
+
+    /**
+     * Outcome of `decodeMessage()`
+     */
+    enum Result {
+        NoMessage,          // Nothing was received
+        Received,           // The message is valid
+        Failed              // The message is invalid, the error code tells why
+    };
+
+    /**
+     * Tells if `pin` is already at `pin_state` on `state`, i.e., the change can be ignored.
+     *
+     * Interruption handlers usually report both pins on every change, so half of the calls end here,
+     * before reading the clock or checking for timeouts.
+     */
+    inline bool pinUnchanged(uint8_t state, uint8_t pin, bool pin_state) {
+        return bool(state & (pin ? PIN_1 : PIN_0)) == pin_state;
+    }
+
+    /**
+     * Updates the level of `pin` in `state` and tells what it means.
+     *
+     * For `DeviceConnected`, `state` is already updated to connected (but unstable).
+     * For `DeviceDisconnected`, the pending message must be flushed before calling `setDisconnected()`.
+     *
+     * This is the reference implementation, see `updatePin()`.
+     */
+    inline PinEvent updatePinBranches(uint8_t& state, uint8_t pin, bool pin_state) {
+        uint8_t pin_mask = pin ? PIN_1 : PIN_0;
+
+        //No change? Abort!
+        if (bool(state & pin_mask) == pin_state) {
+            return PinUnchanged;
+        }
+
+        if (pin_state) {
+            state |= pin_mask;
+        } else {
+            state &= ~pin_mask;
+        }
+
+        //Both pins on: bit received
+        if ((state & MASK_PINS) == MASK_PINS) {
+            //If the device wasn't ready before -- Enable it, and marks state as INVALID until is settles.
+            if (state & DEVICE_CONNECTED) {
+                return BitReceived;
+            } else {
+                //Device connection was detected right now!
+                //Set the device as connected, but unstable
+                state = (state & MASK_STATE) | DEVICE_CONNECTED | ERROR_TRANSMISSION;
+                return DeviceConnected;
+            }
+
+        //Both pins off - Device is unplugged
+        } else if ((state & MASK_PINS) == 0) {
+            if (state & DEVICE_CONNECTED) {
+                //The message being received, if any, is truncated
+                state |= ERROR_TRANSMISSION;
+                return DeviceDisconnected;
+            }
+        }
+        return PinChanged;
+    }
+
+    /**
+     * Entries of the pin transition table, see `updatePinTable()`.
+     *
+     * The low bits are the new pin / connection flags, and `ERROR_TRANSMISSION` if it must be set.
+     * `ERROR_TOO_BIG` is cleared along with the connection (stored on the unused `DEVICE_INITIALIZED` position),
+     * and the `PinEvent` lives on the 3 upper bits.
+     */
+    static const uint8_t TRANSITION_FLAGS     = PIN_0 | PIN_1 | DEVICE_CONNECTED;
+    static const uint8_t TRANSITION_CLEAR     = 0x08;
+    static const uint8_t TRANSITION_EVENT     = 5;
+
+    constexpr uint8_t transitionEntry(uint8_t flags, PinEvent event) {
+        return flags | uint8_t(event << TRANSITION_EVENT);
+    }
+
+    constexpr uint8_t pinTransitionFrom(uint8_t pins, bool connected) {
+        return pins == MASK_PINS
+            ? (connected ? transitionEntry(MASK_PINS | DEVICE_CONNECTED, BitReceived)
+                         : transitionEntry(MASK_PINS | DEVICE_CONNECTED | ERROR_TRANSMISSION | TRANSITION_CLEAR, DeviceConnected))
+            : (pins == 0 && connected ? transitionEntry(DEVICE_CONNECTED | ERROR_TRANSMISSION, DeviceDisconnected)
+                                      : transitionEntry(pins | (connected ? DEVICE_CONNECTED : 0), PinChanged));
+    }
+
+    /**
+     * Transition for an index made of the current pin / connection flags (bits 0-2), the pin (bit 3) and its new level (bit 4)
+     */
+    constexpr uint8_t pinTransition(uint8_t index) {
+        return bool(index & ((index & 0x08) ? PIN_1 : PIN_0)) == bool(index & 0x10)
+            ? transitionEntry(index & TRANSITION_FLAGS, PinUnchanged)
+            : pinTransitionFrom((index & 0x10) ? ((index | ((index & 0x08) ? PIN_1 : PIN_0)) & MASK_PINS)
+                                               : (index & ~((index & 0x08) ? PIN_1 : PIN_0) & MASK_PINS),
+                                index & DEVICE_CONNECTED);
+    }
+
+    /**
+     * Same as `updatePinBranches()`, looking the outcome up in a 32-byte table instead of branching on the state.
+     *
+     * It takes the same time whatever happens, which bounds the time spent in the interruption handler.
+     */
+    inline PinEvent updatePinTable(uint8_t& state, uint8_t pin, bool pin_state) {
+        static const uint8_t TRANSITIONS[32] PROGMEM = {
+            pinTransition(0),  pinTransition(1),  pinTransition(2),  pinTransition(3),
+            pinTransition(4),  pinTransition(5),  pinTransition(6),  pinTransition(7),
+            pinTransition(8),  pinTransition(9),  pinTransition(10), pinTransition(11),
+            pinTransition(12), pinTransition(13), pinTransition(14), pinTransition(15),
+            pinTransition(16), pinTransition(17), pinTransition(18), pinTransition(19),
+            pinTransition(20), pinTransition(21), pinTransition(22), pinTransition(23),
+            pinTransition(24), pinTransition(25), pinTransition(26), pinTransition(27),
+            pinTransition(28), pinTransition(29), pinTransition(30), pinTransition(31),
+        };
+        uint8_t index = (state & TRANSITION_FLAGS) | (uint8_t(pin != 0) << 3) | (uint8_t(pin_state) << 4);
+        uint8_t entry = pgm_read_byte(&TRANSITIONS[index]);
+        state = (state & ~TRANSITION_FLAGS & ~((entry & TRANSITION_CLEAR) << 2)) | (entry & (TRANSITION_FLAGS | ERROR_TRANSMISSION));
+        return PinEvent(entry >> TRANSITION_EVENT);
+    }
+
+    /**
+     * Updates the level of `pin` in `state` and tells what it means. See `updatePinBranches()`.
+     *
+     * With `WIEGAND_TRANSITION_TABLE` defined as 1, the transition table is used instead of branches
+     */
+    inline PinEvent updatePin(uint8_t& state, uint8_t pin, bool pin_state) {
+#if WIEGAND_TRANSITION_TABLE
+        return updatePinTable(state, pin, pin_state);
+#else
+        return updatePinBranches(state, pin, pin_state);
+#endif
+    }
+
+    /**
+     * Sets the state as disconnected, after the truncated message was flushed
+     */
+    inline void setDisconnected(uint8_t& state) {
+        state = (state & MASK_STATE & ~DEVICE_CONNECTED);
+    }
+
+    /**
+     * Resets the state so that it awaits a new message.
+     *
+     * If the data pins aren't high, it sets the `ERROR_TRANSMISSION` flag
+     * to signal it is probably in the middle of a truncated message or something.
+     */
+    template<typename bits_t>
+    inline void resetMessage(uint8_t& state, bits_t& bits) {
+        bits=0;
+        state &= MASK_STATE;
+        //A transmission must start with D0=1, D1=1
+        if ((state & MASK_PINS) != MASK_PINS) {
+            state |= ERROR_TRANSMISSION;
+        }
+    }
+
+    /**
+     * Fractional bits of the learned bit period, see `learnBitPeriod()`
+     */
+    static const uint8_t PERIOD_FRACTION = 4;
+
+    /**
+     * Learns the interval between bits of a reader, with `PERIOD_FRACTION` fractional bits.
+     *
+     * Longer intervals are taken right away, so that a slower reader never has its messages cut short.
+     * Shorter ones are averaged in with a 1/4 weight (EWMA), so that the period only comes down slowly.
+     */
+    inline void learnBitPeriod(unsigned long& period, unsigned long interval) {
+        unsigned long sample = interval << PERIOD_FRACTION;
+        if (sample >= period) {
+            period = sample;
+        } else {
+            period -= (period - sample) >> 2;
+        }
+    }
+
+    /**
+     * Quiet time that ends a message: `multiple` times the learned bit period, between `min_timeout` and `max_timeout`.
+     *
+     * Until a period is learned, it is `max_timeout`
+     */
+    inline unsigned long adaptiveTimeout(unsigned long period, uint8_t multiple, unsigned long min_timeout, unsigned long max_timeout) {
+        if (period == 0) {
+            return max_timeout;
+        }
+        unsigned long timeout = (period * multiple + (1 << PERIOD_FRACTION) - 1) >> PERIOD_FRACTION;
+        return timeout < min_timeout ? min_timeout : (timeout > max_timeout ? max_timeout : timeout);
+    }
+
+    /**
+     * Shifts a new bit into the accumulator.
+     *
+     * When the accumulator is full, its oldest byte is moved to `data`.
+     * Bits past `MAX_BITS` are dropped and flagged with `ERROR_TOO_BIG`.
+     */
+    template<uint16_t MAX_BITS=Wiegand::MAX_BITS, typename bits_t>
+    inline void addBit(uint8_t& state, bits_t& bits, Wiegand::accumulator_t& accumulator, uint8_t* data, bool value) {
+        const uint8_t ACCUMULATOR_BITS = Wiegand::ACCUMULATOR_BITS;
+
+        //Skip if we have too much data
+        if (bits >= MAX_BITS) {
+            state |= ERROR_TOO_BIG;
+            return;
+        }
+
+        //Accumulator is full: Its oldest byte is moved to `data`
+        if (MAX_BITS > ACCUMULATOR_BITS && bits >= ACCUMULATOR_BITS && (bits & 7) == 0) {
+            data[(bits - ACCUMULATOR_BITS) >> 3] = uint8_t(accumulator >> (ACCUMULATOR_BITS - 8));
+        }
+        accumulator = (accumulator << 1) | value;
+        bits++;
+    }
+
+    /**
+     * Moves the received bits from the accumulator into `data`, aligned to the right.
+     *
+     * Messages that fit in the accumulator are copied out directly. Longer messages have
+     * their first bytes already spilled into `data`, so the tail is appended and the whole
+     * buffer is aligned once.
+     */
+    template<uint16_t MAX_BITS=Wiegand::MAX_BITS, typename bits_t>
+    inline void collectBits(uint8_t* data, bits_t bits, Wiegand::accumulator_t accumulator) {
+        const uint16_t MAX_BYTES = (MAX_BITS + 7) / 8;
+        const uint8_t ACCUMULATOR_BITS = Wiegand::ACCUMULATOR_BITS;
+
+        if (MAX_BITS <= ACCUMULATOR_BITS || bits <= ACCUMULATOR_BITS) {
+            for (int8_t i=(bits+7)/8 - 1; i>=0; i--) {
+                data[i] = uint8_t(accumulator);
+                accumulator >>= 8;
+            }
+            data[0] &= 0xFF >> (8*((bits+7)/8) - bits);
+        } else {
+            bits_t spilled = (bits - ACCUMULATOR_BITS + 7) / 8;
+            uint8_t pending = bits - 8*spilled;
+            accumulator <<= ACCUMULATOR_BITS - pending;
+            for (bits_t i=spilled; i<(bits+7)/8 && i<MAX_BYTES; i++) {
+                data[i] = uint8_t(accumulator >> (ACCUMULATOR_BITS - 8));
+                accumulator <<= 8;
+            }
+            align_data(data, 0, bits);
+        }
+    }
+
+    /**
+     * The raw message as an integer, with the last bit received on bit 0.
+     *
+     * Messages that fit in the accumulator are read from it directly, longer ones from `data`.
+     */
+    inline uint64_t messageValue(const uint8_t* data, uint8_t bits, Wiegand::accumulator_t accumulator) {
+        if (bits <= Wiegand::ACCUMULATOR_BITS) {
+            return uint64_t(accumulator) & (~uint64_t(0) >> (64 - bits));
+        }
+        return WiegandFormats::value(data, bits);
+    }
+
+    /**
+     * Verifies if the message is valid and decodes it.
+     *
+     * On return, `data` and `bits` hold the payload that must be sent to the data callback (on `Received`)
+     * or the raw message that must be sent to the error callback (on `Failed`).
+     *
+     * If `credential` is given, the fields of card formats are extracted into it.
+     * Its format is `WiegandFormat::Unknown` for anything else.
+     *
+     * Card formats only go up to 64 bits: Longer messages can only be received with `decode_messages=false`.
+     *
+     * If `fixed` is given, messages of its size are decoded with it alone, without looking up `WiegandFormats`.
+     * When it is a constant, its parity checks and fields are inlined (See `StaticWiegand`).
+     */
+    template<uint16_t MAX_BITS=Wiegand::MAX_BITS, typename bits_t>
+    inline Result decodeMessage(uint8_t state, bits_t expected_bits, bool decode_messages,
+                                uint8_t* data, bits_t& bits, Wiegand::accumulator_t accumulator,
+                                Wiegand::DataError& error, WiegandCredential* credential=nullptr,
+                                const WiegandFormat* fixed=nullptr) {
+        if (credential) {
+            credential->format = WiegandFormat::Unknown;
+        }
+
+        //Ignore empty messages
+        if ((bits == 0) || (expected_bits == 0)) {
+            return NoMessage;
+        }
+
+        //From here on, `data` holds the raw message, aligned to the right
+        collectBits<MAX_BITS>(data, bits, accumulator);
+
+        //Check for pending errors
+        if (state & MASK_ERRORS) {
+            error = (state & ERROR_TOO_BIG) ? Wiegand::SizeTooBig : Wiegand::Communication;
+            return Failed;
+        }
+
+        //Validate the message size
+        if ((expected_bits != bits) && (expected_bits != Wiegand::LENGTH_ANY)) {
+            error = Wiegand::SizeUnexpected;
+            return Failed;
+        }
+
+        //Decode the message
+        if (!decode_messages) {
+            return Received;
+        }
+
+        //4-bit keycode: No check necessary
+        if ((bits == 4)) {
+            return Received;
+
+        //8-bit keybode: UpperNibble = ~lowerNibble
+        } else if ((bits == 8)) {
+            uint8_t value = data[0] & 0xF;
+            if (data[0] == (value | ((0xF & ~value)<<4))) {
+                data[0] = value;
+                bits = 4;
+                return Received;
+            }
+            error = Wiegand::VerificationFailed;
+            return Failed;
+        }
+
+        //Card formats: The first one of this size that passes the parity checks. See `WiegandFormats`
+        WiegandFormat found;
+        const WiegandFormat* format = &found;
+        if (bits > 64) {
+            error = Wiegand::DecodeFailed;
+            return Failed;
+        }
+        uint64_t message = messageValue(data, bits, accumulator);
+        if (fixed && fixed->bits == bits) {
+            format = fixed;
+            if (!format->checkParity(message)) {
+                error = Wiegand::VerificationFailed;
+                return Failed;
+            }
+        } else if (!WiegandFormats::match(bits, message, found)) {
+            //Tell apart unknown sizes from parity errors
+            error = WiegandFormats::find(bits, found) ? Wiegand::VerificationFailed : Wiegand::DecodeFailed;
+            return Failed;
+        }
+        if (credential) {
+            credential->format = format->id;
+            credential->facility = format->facility(message);
+            credential->card = format->card(message);
+        }
+        uint8_t padding = 8*((bits+7)/8) - bits;
+        bits = align_data(data, padding + format->payload_offset, padding + format->payload_offset + format->payload_bits);
+        return Received;
+    }
+}
@@ -0,0 +1,87 @@
+#include <WiegandFormats.h>
+#include <Arduino.h>
+#include <string.h>
+
+constexpr WiegandFormat WiegandFormats::H10301;
+constexpr WiegandFormat WiegandFormats::H10306;
+constexpr WiegandFormat WiegandFormats::H10304;
+constexpr WiegandFormat WiegandFormats::H10302;
+constexpr WiegandFormat WiegandFormats::CORPORATE1000_35;
+constexpr WiegandFormat WiegandFormats::C15001;
+constexpr WiegandFormat WiegandFormats::CORPORATE1000_48;
+
+/**
+ * Built-in formats. They live in flash on AVRs, where this table alone would eat a good share of the RAM.
+ *
+ * H10302 is left out: It would never match, since H10304 takes all the messages it accepts
+ */
+static constexpr WiegandFormat BUILTIN_FORMATS[] PROGMEM = {
+    WiegandFormats::H10301,
+    WiegandFormats::H10306,
+    WiegandFormats::H10304,
+    WiegandFormats::CORPORATE1000_35,
+    WiegandFormats::C15001,
+    WiegandFormats::CORPORATE1000_48,
+};
+
+static const uint8_t BUILTIN_COUNT = sizeof(BUILTIN_FORMATS) / sizeof(BUILTIN_FORMATS[0]);
+
+const WiegandFormat* WiegandFormats::custom[WIEGAND_MAX_CUSTOM_FORMATS];
+uint8_t WiegandFormats::custom_count = 0;
+
+bool WiegandFormats::add(const WiegandFormat& format) {
+    if (custom_count >= WIEGAND_MAX_CUSTOM_FORMATS || format.bits > 64) {
+        return false;
+    }
+    custom[custom_count++] = &format;
+    return true;
+}
+
+void WiegandFormats::clear() {
+    custom_count = 0;
+}
+
+bool WiegandFormats::find(uint8_t bits, WiegandFormat& format) {
+    for (uint8_t i=0; i<custom_count; i++) {
+        if (custom[i]->bits == bits) {
+            format = *custom[i];
+            return true;
+        }
+    }
+    for (uint8_t i=0; i<BUILTIN_COUNT; i++) {
+        if (pgm_read_byte(&BUILTIN_FORMATS[i].bits) == bits) {
+            memcpy_P(&format, &BUILTIN_FORMATS[i], sizeof(WiegandFormat));
+            return true;
+        }
+    }
+    return false;
+}
+
+bool WiegandFormats::match(uint8_t bits, uint64_t message, WiegandFormat& format) {
+    for (uint8_t i=0; i<custom_count; i++) {
+        if (custom[i]->bits == bits && custom[i]->checkParity(message)) {
+            format = *custom[i];
+            return true;
+        }
+    }
+    for (uint8_t i=0; i<BUILTIN_COUNT; i++) {
+        if (pgm_read_byte(&BUILTIN_FORMATS[i].bits) == bits) {
+            memcpy_P(&format, &BUILTIN_FORMATS[i], sizeof(WiegandFormat));
+            if (format.checkParity(message)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool WiegandFormats::detect(uint8_t bits, uint64_t message, WiegandCredential& credential) {
+    WiegandFormat format;
+    if (!match(bits, message, format)) {
+        return false;
+    }
+    credential.format = format.id;
+    credential.facility = format.facility(message);
+    credential.card = format.card(message);
+    return true;
+}
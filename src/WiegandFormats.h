@@ -0,0 +1,239 @@
+/*
+ * Card formats: message size, parity bits and fields of each known Wiegand format.
+ *
+ * Each format is described by a table entry instead of code. Parity is verified with one mask per
+ * parity bit, covering the parity bit itself and every bit it protects, so that checking a message
+ * takes a couple of AND + parity instructions, no matter how the covered bits are spread.
+ * Masks are aligned to the end of the message, whose size is only known once it ends: Nothing is
+ * tracked while bits arrive, and the raw message is read from the accumulator when it fits.
+ *
+ * Bit positions are counted from the first bit received, starting at 0.
+ */
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * How many custom formats may be registered with `WiegandFormats::add()`
+ */
+#ifndef WIEGAND_MAX_CUSTOM_FORMATS
+#  define WIEGAND_MAX_CUSTOM_FORMATS 4
+#endif
+
+/**
+ * A parity bit: The bits covered by `mask` must have odd (or even) parity
+ */
+struct WiegandParity {
+    /**
+     * Covered bits, including the parity bit itself. The last bit received is bit 0 of the mask
+     */
+    uint64_t mask;
+    bool odd;
+};
+
+/**
+ * Describes a card format. Fields with 0 bits are not present on the format
+ */
+struct WiegandFormat {
+    /**
+     * Formats known by the library. Custom formats should use ids from `Custom` on
+     */
+    enum Id : uint8_t {
+        Unknown = 0,
+        H10301,             // 26-bit: 8-bit facility, 16-bit card
+        H10306,             // 34-bit: 16-bit facility, 16-bit card
+        H10304,             // 37-bit: 16-bit facility, 19-bit card
+        H10302,             // 37-bit: 35-bit card, no facility
+        Corporate1000_35,   // 35-bit: 12-bit company, 20-bit card
+        C15001,             // 36-bit (Keyscan): 10-bit OEM code, 8-bit facility, 16-bit card
+        Corporate1000_48,   // 48-bit: 22-bit company, 23-bit card
+        Custom = 0x80
+    };
+
+    static const uint8_t MAX_PARITY = 3;
+
+    uint8_t id;
+    uint8_t bits;
+    WiegandParity parity[MAX_PARITY];
+
+    /**
+     * Bits sent to the data callback, usually everything but the parity bits
+     */
+    uint8_t payload_offset, payload_bits;
+    uint8_t facility_offset, facility_bits;
+    uint8_t card_offset, card_bits;
+
+    /**
+     * Mask covering bits `first` to `last` (inclusive) of a `bits`-long message
+     */
+    static constexpr uint64_t range(uint8_t bits, uint8_t first, uint8_t last) {
+        return ((uint64_t(2) << (last - first)) - 1) << (bits - 1 - last);
+    }
+
+    /**
+     * Mask covering bits `first` to `last` of a `bits`-long message, except those where `position % 3 == skip`.
+     *
+     * Corporate 1000 parity bits cover 2 out of every 3 bits.
+     */
+    static constexpr uint64_t twoOfThree(uint8_t bits, uint8_t first, uint8_t last, uint8_t skip) {
+        return first > last ? 0 : ((first % 3 != skip ? range(bits, first, first) : 0) | twoOfThree(bits, first + 1, last, skip));
+    }
+
+    /**
+     * Reads `width` bits of `message` starting at `offset`
+     */
+    inline uint64_t field(uint64_t message, uint8_t offset, uint8_t width) const {
+        return width ? (message >> (bits - offset - width)) & (~uint64_t(0) >> (64 - width)) : 0;
+    }
+
+    inline uint32_t facility(uint64_t message) const {
+        return uint32_t(field(message, facility_offset, facility_bits));
+    }
+
+    inline uint64_t card(uint64_t message) const {
+        return field(message, card_offset, card_bits);
+    }
+
+    /**
+     * Verifies all parity bits of `message`, the raw message aligned to the right
+     */
+    inline bool checkParity(uint64_t message) const {
+        for (uint8_t i=0; i<MAX_PARITY; i++) {
+            if (__builtin_parityll(message & parity[i].mask) != parity[i].odd) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+/**
+ * The fields of a decoded card
+ */
+struct WiegandCredential {
+    uint8_t format;     // `WiegandFormat::Id`, or the id of a custom format
+    uint32_t facility;  // 0 on formats without a facility code
+    uint64_t card;
+};
+
+/**
+ * Registry of the formats used to decode messages.
+ *
+ * Formats with the same size are tried in priority order, until one of them passes the parity checks:
+ * Custom formats first, in the order they were registered, then the built-in ones, in the order they are declared
+ * on `WiegandFormat::Id`.
+ *
+ * H10302 has the same size and parity bits as H10304, so no message can tell them apart: It isn't tried unless it
+ * is registered with `WiegandFormats::add(WiegandFormats::H10302)`, and then 37-bit messages are always reported as H10302.
+ */
+class WiegandFormats {
+public:
+    /**
+     * Layouts of the known formats, to be registered with `add()` or given to `StaticWiegand`
+     */
+    static constexpr WiegandFormat H10301 = {WiegandFormat::H10301, 26,
+        {{WiegandFormat::range(26, 0, 12), false}, {WiegandFormat::range(26, 13, 25), true}, {0, false}},
+        1, 24,  1, 8,  9, 16};
+    static constexpr WiegandFormat H10306 = {WiegandFormat::H10306, 34,
+        {{WiegandFormat::range(34, 0, 16), false}, {WiegandFormat::range(34, 17, 33), true}, {0, false}},
+        1, 32,  1, 16,  17, 16};
+    static constexpr WiegandFormat H10304 = {WiegandFormat::H10304, 37,
+        {{WiegandFormat::range(37, 0, 18), false}, {WiegandFormat::range(37, 18, 36), true}, {0, false}},
+        1, 35,  1, 16,  17, 19};
+    static constexpr WiegandFormat H10302 = {WiegandFormat::H10302, 37,
+        {{WiegandFormat::range(37, 0, 18), false}, {WiegandFormat::range(37, 18, 36), true}, {0, false}},
+        1, 35,  0, 0,  1, 35};
+    static constexpr WiegandFormat CORPORATE1000_35 = {WiegandFormat::Corporate1000_35, 35,
+        {{WiegandFormat::range(35, 0, 34), true},
+         {WiegandFormat::range(35, 1, 1) | WiegandFormat::twoOfThree(35, 2, 33, 1), false},
+         {WiegandFormat::twoOfThree(35, 1, 33, 0) | WiegandFormat::range(35, 34, 34), true}},
+        2, 32,  2, 12,  14, 20};
+    static constexpr WiegandFormat C15001 = {WiegandFormat::C15001, 36,
+        {{WiegandFormat::range(36, 0, 17), false}, {WiegandFormat::range(36, 18, 35), true}, {0, false}},
+        1, 34,  11, 8,  19, 16};
+    static constexpr WiegandFormat CORPORATE1000_48 = {WiegandFormat::Corporate1000_48, 48,
+        {{WiegandFormat::range(48, 0, 47), true},
+         {WiegandFormat::range(48, 1, 1) | WiegandFormat::twoOfThree(48, 2, 46, 1), false},
+         {WiegandFormat::twoOfThree(48, 1, 46, 0) | WiegandFormat::range(48, 47, 47), true}},
+        2, 45,  2, 22,  24, 23};
+
+    /**
+     * Registers a custom format. `format` is not copied, it must outlive the registration.
+     *
+     * Returns false if there are already `WIEGAND_MAX_CUSTOM_FORMATS` formats registered,
+     * or if the format is longer than 64 bits, which no message could match
+     */
+    static bool add(const WiegandFormat& format);
+
+    /**
+     * Removes all custom formats
+     */
+    static void clear();
+
+    /**
+     * Finds the format used for messages with `bits` bits and copies it into `format`.
+     *
+     * Returns false if no format has this size.
+     */
+    static bool find(uint8_t bits, WiegandFormat& format);
+
+    /**
+     * Finds the first format with `bits` bits whose parity checks accept `message` and copies it into `format`.
+     *
+     * `message` is the raw message, with the last bit received on bit 0
+     */
+    static bool match(uint8_t bits, uint64_t message, WiegandFormat& format);
+
+    /**
+     * Detects the format of a raw message and extracts its fields into `credential`.
+     *
+     * Returns false if no format matches.
+     */
+    static bool detect(uint8_t bits, uint64_t message, WiegandCredential& credential);
+
+    /**
+     * Same as above, with the raw message as received on the data callback with `decode_messages=false`
+     */
+    static inline bool detect(const uint8_t* data, uint8_t bits, WiegandCredential& credential) {
+        return bits <= 64 && detect(bits, value(data, bits), credential);
+    }
+
+    /**
+     * Reads a raw message, aligned to the right in `data`, as an integer
+     */
+    static inline uint64_t value(const uint8_t* data, uint8_t bits) {
+        uint64_t value = 0;
+        for (uint8_t i=0; i<(bits+7)/8 && i<8; i++) {
+            value = (value << 8) | data[i];
+        }
+        return value;
+    }
+
+    /**
+     * Gets the name of a built-in format
+     */
+    static inline const char* name(uint8_t id) {
+        switch (id) {
+            case WiegandFormat::H10301:
+                return "H10301";
+            case WiegandFormat::H10306:
+                return "H10306";
+            case WiegandFormat::H10304:
+                return "H10304";
+            case WiegandFormat::H10302:
+                return "H10302";
+            case WiegandFormat::Corporate1000_35:
+                return "Corporate 1000 (35-bit)";
+            case WiegandFormat::C15001:
+                return "C15001";
+            case WiegandFormat::Corporate1000_48:
+                return "Corporate 1000 (48-bit)";
+            default:
+                return id >= WiegandFormat::Custom ? "Custom" : "Unknown";
+        }
+    }
+
+private:
+    static const WiegandFormat* custom[WIEGAND_MAX_CUSTOM_FORMATS];
+    static uint8_t custom_count;
+};
@@ -0,0 +1,213 @@
+/*
+ * Lock-free queues of received messages.
+ *
+ * Instead of handling messages inside the data callbacks (which may run inside an
+ * interruption handler), messages are stored in a fixed-capacity queue and the
+ * application takes them out whenever it is convenient.
+ *
+ * `WiegandFrameQueue` keeps the messages as received by the data and error callbacks,
+ * `WiegandCredentialQueue` keeps only the decoded cards.
+ */
+#pragma once
+
+#include <Wiegand.h>
+#include <WiegandRingBuffer.h>
+
+/**
+ * A message, as received by the data or error callbacks
+ */
+struct WiegandFrame {
+    /**
+     * Payload, aligned to the right. It is the decoded message, or the raw message in case of errors
+     */
+    uint8_t data[Wiegand::MAX_BYTES];
+
+    /**
+     * Number of bits in `data`
+     */
+    uint8_t bits;
+
+    /**
+     * Whether the message was received successfully. Otherwise, `error` tells what went wrong
+     */
+    bool valid;
+    Wiegand::DataError error;
+
+    /**
+     * When the last bit of the message was received, in milliseconds
+     */
+    unsigned long timestamp;
+};
+
+/**
+ * `CAPACITY` is the number of messages that can wait in the queue. It must be a power of 2, up to 128
+ */
+template<uint8_t CAPACITY=4>
+class WiegandFrameQueue {
+private:
+    WiegandRingBuffer<WiegandFrame, CAPACITY> frames;
+    volatile uint8_t dropped_frames;
+
+    /**
+     * Copies a message into the next free slot
+     */
+    inline void push(Wiegand* wiegand, bool valid, Wiegand::DataError error, const uint8_t* data, uint8_t bits) {
+        WiegandFrame* frame = frames.claim();
+        if (!frame) {
+            dropped_frames = dropped_frames + 1;
+            return;
+        }
+        for (uint8_t i=0; i<(bits+7)/8; i++) {
+            frame->data[i] = data[i];
+        }
+        frame->bits = bits;
+        frame->valid = valid;
+        frame->error = error;
+        frame->timestamp = wiegand->lastEventTime();
+        frames.publish();
+    }
+
+    struct Source {
+        WiegandFrameQueue* queue;
+        Wiegand* wiegand;
+    } source;
+
+    static void onData(uint8_t* data, uint8_t bits, Source* source) {
+        source->queue->push(source->wiegand, true, Wiegand::Communication, data, bits);
+    }
+
+    static void onError(Wiegand::DataError error, uint8_t* data, uint8_t bits, Source* source) {
+        source->queue->push(source->wiegand, false, error, data, bits);
+    }
+
+public:
+    WiegandFrameQueue() : dropped_frames(0) {}
+
+    /**
+     * Sends all messages received by `wiegand` to this queue.
+     *
+     * This replaces its data and error callbacks.
+     */
+    void attach(Wiegand& wiegand) {
+        source.queue = this;
+        source.wiegand = &wiegand;
+        wiegand.onReceive(onData, &source);
+        wiegand.onReceiveError(onError, &source);
+    }
+
+    /**
+     * Takes the oldest message out of the queue.
+     *
+     * Returns false if there are no messages.
+     */
+    inline bool tryPop(WiegandFrame& frame) {
+        return frames.pop(frame);
+    }
+
+    /**
+     * Gets the oldest message, without taking it out of the queue.
+     *
+     * Returns nullptr if there are no messages. Call `pop()` when done with it.
+     */
+    inline const WiegandFrame* peek() {
+        return frames.peek();
+    }
+
+    /**
+     * Discards the oldest message
+     */
+    inline void pop() {
+        frames.discard();
+    }
+
+    /**
+     * Number of messages waiting in the queue
+     */
+    inline uint8_t size() const {
+        return frames.size();
+    }
+
+    inline bool empty() const {
+        return frames.empty();
+    }
+
+    /**
+     * Number of messages lost because the queue was full (wraps around after 255)
+     */
+    inline uint8_t dropped() const {
+        return dropped_frames;
+    }
+};
+
+/**
+ * Queue of decoded cards, as received by the credential callback.
+ *
+ * `CAPACITY` is the number of cards that can wait in the queue. It must be a power of 2, up to 128
+ */
+template<uint8_t CAPACITY=4>
+class WiegandCredentialQueue {
+private:
+    WiegandRingBuffer<WiegandCredential, CAPACITY> credentials;
+    volatile uint8_t dropped_credentials;
+
+    static void onCredential(const WiegandCredential& credential, WiegandCredentialQueue* queue) {
+        if (!queue->credentials.push(credential)) {
+            queue->dropped_credentials = queue->dropped_credentials + 1;
+        }
+    }
+
+public:
+    WiegandCredentialQueue() : dropped_credentials(0) {}
+
+    /**
+     * Sends all cards decoded by `wiegand` to this queue.
+     *
+     * This replaces its credential callback. Data and error callbacks are left alone.
+     */
+    void attach(Wiegand& wiegand) {
+        wiegand.onCredential(onCredential, this);
+    }
+
+    /**
+     * Takes the oldest card out of the queue.
+     *
+     * Returns false if there are no cards.
+     */
+    inline bool tryPop(WiegandCredential& credential) {
+        return credentials.pop(credential);
+    }
+
+    /**
+     * Gets the oldest card, without taking it out of the queue.
+     *
+     * Returns nullptr if there are no cards. Call `pop()` when done with it.
+     */
+    inline const WiegandCredential* peek() {
+        return credentials.peek();
+    }
+
+    /**
+     * Discards the oldest card
+     */
+    inline void pop() {
+        credentials.discard();
+    }
+
+    /**
+     * Number of cards waiting in the queue
+     */
+    inline uint8_t size() const {
+        return credentials.size();
+    }
+
+    inline bool empty() const {
+        return credentials.empty();
+    }
+
+    /**
+     * Number of cards lost because the queue was full (wraps around after 255)
+     */
+    inline uint8_t dropped() const {
+        return dropped_credentials;
+    }
+};
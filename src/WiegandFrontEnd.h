@@ -0,0 +1,238 @@
+/*
+ * Message handling shared by the single-reader decoders built at compile time
+ * (`StaticWiegand`, `CompactWiegand` and `InlineWiegand`).
+ *
+ * It keeps the fields of the reader and implements the public API around `WiegandCore`:
+ * Timeouts, pin changes and message decoding. The decoders only add their configuration
+ * and the way events are sent out (CRTP), so the compiler still inlines everything.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <Wiegand.h>
+#include <WiegandCore.h>
+
+/**
+ * `Derived` is the decoder, which must provide (to this class, e.g. as a friend):
+ * - `bits_t expectedBits()`, `bool decodeMessages()`: Same as the arguments of `Wiegand::begin()`.
+ * - `const WiegandFormat* fixedFormat()`: Format decoded without a lookup, see `WiegandCore::decodeMessage()`.
+ * - `bool wantsCredential()`: Tells if the fields of card formats must be extracted.
+ * - `dispatchMessage(data, bits, credential)`, with `credential` null when it wasn't extracted or is unknown,
+ *   `dispatchError(error, data, bits)` and `dispatchState(plugged)`: Send the events out.
+ *
+ * `timestamp_t` is the type that keeps the time of the last event: Smaller types wrap around,
+ * and a gap that ends within `Wiegand::TIMEOUT` of a multiple of their range is taken as a short one.
+ */
+template<typename Derived, uint16_t MAX_BITS, typename bits_t=uint8_t, typename timestamp_t=unsigned long>
+class WiegandFrontEnd {
+public:
+    static const uint16_t MAX_BYTES = (MAX_BITS + 7) / 8;
+
+protected:
+    //Widest fields first, so that the fields of `Derived` can take the padding at the end
+    Wiegand::accumulator_t accumulator;
+    timestamp_t timestamp;
+    uint8_t state;
+    bits_t bits;
+    uint8_t data[MAX_BYTES];
+
+    WiegandFrontEnd() : accumulator(0), timestamp(0), state(0), bits(0) {
+        memset(data, 0, sizeof(data));
+    }
+
+    inline Derived& derived() {
+        return *static_cast<Derived*>(this);
+    }
+
+    /**
+     * Sets the device as "initialized" and resets it to wait a new message.
+     *
+     * `config` are the configuration flags kept in the state (See `WiegandCore::DECODE_MESSAGES`)
+     */
+    void initialize(uint8_t config) {
+        using namespace WiegandCore;
+        bits = 0;
+        timestamp = timestamp_t(Wiegand::now());
+        //Set state as "INVALID", so that data can only be received after a few millis in "ready" state
+        state = (state & MASK_STATE & ~DECODE_MESSAGES) | DEVICE_INITIALIZED | ERROR_TRANSMISSION | config;
+    }
+
+    /**
+     * Verifies if the current buffer is valid and sends it out.
+     * If the buffer is invalid, it is discarded
+     */
+    void flushData() {
+        using namespace WiegandCore;
+        //Ignore messages before `begin()` or after `end()`
+        if (!(state & DEVICE_INITIALIZED)) {
+            return;
+        }
+
+        Wiegand::DataError error;
+        WiegandCredential credential;
+        bool extract = derived().wantsCredential();
+        switch (decodeMessage<MAX_BITS, bits_t>(state, derived().expectedBits(), derived().decodeMessages(), data, bits, accumulator, error,
+                                                    extract ? &credential : nullptr, derived().fixedFormat())) {
+            case Received:
+                derived().dispatchMessage(data, bits, extract && credential.format != WiegandFormat::Unknown ? &credential : nullptr);
+                break;
+            case Failed:
+                derived().dispatchError(error, data, bits);
+                break;
+            case NoMessage:
+                break;
+        }
+    }
+
+public:
+    /**
+    * Sets the device as "not-initialized"
+    */
+    void end() {
+        using namespace WiegandCore;
+        bits = 0;
+        timestamp = timestamp_t(Wiegand::now());
+        state &= MASK_STATE & ~DEVICE_INITIALIZED;
+    }
+
+    /**
+     * Resets the state so that it awaits a new message.
+     */
+    inline void reset() {
+        WiegandCore::resetMessage(state, bits);
+    }
+
+    /**
+     * Returns if this device is initialized (with `begin()`) and a reader has been connected.
+     */
+    operator bool() {
+        using namespace WiegandCore;
+        return (state & (DEVICE_CONNECTED|DEVICE_INITIALIZED)) == (DEVICE_CONNECTED|DEVICE_INITIALIZED);
+    }
+
+    /**
+     * Time (in milliseconds) of the last pin change, truncated to `timestamp_t`.
+     */
+    inline timestamp_t lastEventTime() {
+        return timestamp;
+    }
+
+    /**
+     * Level of a pin, as last reported with `setPinState()`
+     */
+    inline bool pinState(uint8_t pin) {
+        return !WiegandCore::pinUnchanged(state, pin, false);
+    }
+
+    /**
+     * Tells when the message being received times out, i.e., the first time at which `flush()` would send it out.
+     *
+     * Returns false if there is no message being received: Nothing can happen until the next pin change.
+     * That includes the settle time after a reader is connected, which the next pin change ends on its own.
+     *
+     * Timestamps smaller than `unsigned long` are extended using the current time.
+     */
+    bool nextDeadline(unsigned long& deadline) {
+        if (sizeof(timestamp_t) < sizeof(unsigned long)) {
+            unsigned long now = Wiegand::now();
+            timestamp_t elapsed = timestamp_t(now) - timestamp;
+            deadline = elapsed > Wiegand::TIMEOUT ? now : now + (Wiegand::TIMEOUT + 1 - elapsed);
+        } else {
+            deadline = timestamp + Wiegand::TIMEOUT + 1;
+        }
+        return bits > 0;
+    }
+
+    /**
+     * Same as `flush()`, but with the current time provided by the caller.
+     *
+     * `now` must not be older than the last event
+     */
+    void flush(unsigned long now) {
+        // Resets state if nothing happened in a few milliseconds
+        if (timestamp_t(timestamp_t(now) - timestamp) > Wiegand::TIMEOUT) {
+            // Might have a pending data package
+            flushData();
+            reset();
+        }
+    }
+
+    /**
+     * Clean up state after `Wiegand::TIMEOUT` milliseconds without events
+     */
+    inline void flush() {
+        flush(Wiegand::now());
+    }
+
+    /**
+    * Immediately cleans up state, sending out pending messages and calling `reset()`
+    */
+    void flushNow() {
+        flushData();
+        reset();
+    }
+
+    /**
+    * Updates the state of a pin, which changed at `timestamp` milliseconds.
+    */
+    void setPinState(uint8_t pin, bool pin_state, unsigned long timestamp) {
+        using namespace WiegandCore;
+        //No change? Abort!
+        if (pinUnchanged(state, pin, pin_state)) {
+            return;
+        }
+        //A long enough gap since the previous change ends the pending message
+        flush(timestamp);
+        this->timestamp = timestamp_t(timestamp);
+
+        switch (updatePin(state, pin, pin_state)) {
+            case BitReceived: {
+                addBit<MAX_BITS>(state, bits, accumulator, data, pin);
+                // If we know the number of bits, there is no need to wait for the timeout to send the data
+                bits_t expected_bits = derived().expectedBits();
+                if (expected_bits != Wiegand::LENGTH_ANY && bits == expected_bits) {
+                    flushNow();
+                }
+                break;
+            }
+
+            case DeviceConnected:
+                derived().dispatchState(true);
+                break;
+
+            case DeviceDisconnected:
+                //Flush truncated message, if any, and resets state
+                flushNow();
+                setDisconnected(state);
+                derived().dispatchState(false);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    /**
+    * Updates the state of a pin.
+    */
+    inline void setPinState(uint8_t pin, bool pin_state) {
+        //Only read the clock for actual changes
+        if (!WiegandCore::pinUnchanged(state, pin, pin_state)) {
+            setPinState(pin, pin_state, Wiegand::now());
+        }
+    }
+
+    /**
+     * Notifies the library that the pin Data0 has changed to `pin_state`
+     */
+    inline void setPin0State(bool state) {
+      setPinState(0, state);
+    }
+
+    /**
+     * Notifies the library that the pin Data1 has changed to `pin_state`
+     */
+    inline void setPin1State(bool state) {
+      setPinState(1, state);
+    }
+};
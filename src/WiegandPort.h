@@ -0,0 +1,105 @@
+/*
+ * Decodes up to 4 Wiegand readers wired to the same 8-bit GPIO port.
+ *
+ * A single interrupt handler reads the whole port once and passes it to `setPortState()`.
+ * Changes are detected for all channels at once with bitwise operations, and the usual case
+ * (a single pin of a connected reader rising to complete a bit, or falling to start one)
+ * goes straight to the bit accumulator, without going through `setPinState()` pin by pin.
+ *
+ * Port layout: Data0 of channel `i` on bit `2*i`, Data1 of channel `i` on bit `2*i+1`.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <WiegandBank.h>
+
+/**
+ * `CHANNELS` is the number of readers on the port, up to 4.
+ *
+ * `MAX_BITS` and `bits_t` size the per-channel buffer and bit counter, like on `StaticWiegand`
+ */
+template<uint8_t CHANNELS, uint16_t MAX_BITS=Wiegand::MAX_BITS, typename bits_t=uint8_t>
+class WiegandPort : public WiegandBank<CHANNELS, MAX_BITS, bits_t> {
+    static_assert(CHANNELS > 0 && CHANNELS <= 4, "WiegandPort supports up to 4 channels on an 8-bit port");
+
+private:
+    typedef WiegandBank<CHANNELS, MAX_BITS, bits_t> Bank;
+
+    /**
+     * One bit per channel, on the position of its Data0 pin
+     */
+    static const uint8_t CHANNEL_MASK = uint8_t(0x55 >> (8 - 2*CHANNELS));
+
+    /**
+     * Last port sample
+     */
+    uint8_t port;
+
+    /**
+     * Channels with a connected reader, on the position of their Data0 pin
+     */
+    uint8_t connected_channels;
+
+public:
+    WiegandPort() : Bank(), port(0), connected_channels(0) {}
+
+    /**
+     * Updates the state of all channels from a port sample taken at `timestamp` milliseconds.
+     *
+     * Pins are processed in order (Data0 before Data1) if both pins of a channel changed at once,
+     * just like calling `setPin0State()` and `setPin1State()` on each channel.
+     */
+    void setPortState(uint8_t sample, unsigned long timestamp) {
+        using namespace WiegandCore;
+
+        uint8_t changed = (sample ^ port) & uint8_t(CHANNEL_MASK | (CHANNEL_MASK << 1));
+        if (!changed) {
+            return;
+        }
+        port = sample;
+
+        // Per channel, on the position of Data0
+        uint8_t d0 = sample & CHANNEL_MASK;
+        uint8_t d1 = (sample >> 1) & CHANNEL_MASK;
+        uint8_t d0_changed = changed & CHANNEL_MASK;
+        uint8_t d1_changed = (changed >> 1) & CHANNEL_MASK;
+
+        // Single pin changes that complete a bit on a connected reader, or that leave one pin high and the other low
+        uint8_t single = d0_changed ^ d1_changed;
+        uint8_t bit_received = single & d0 & d1 & connected_channels;
+        uint8_t pin_changed = single & (d0 ^ d1);
+        // Anything else (connection, disconnection, both pins at once) takes the slow path
+        uint8_t slow = (d0_changed | d1_changed) & ~(bit_received | pin_changed);
+
+        for (uint8_t channel=0, mask=0x01; channel<CHANNELS; channel++, mask <<= 2) {
+            if (!((d0_changed | d1_changed) & mask)) {
+                continue;
+            }
+            Bank::timeoutChannel(channel, timestamp);
+
+            if (slow & mask) {
+                if (d0_changed & mask) {
+                    Bank::handleEvent(channel, updatePin(Bank::state[channel], 0, d0 & mask), 0, timestamp);
+                }
+                if (d1_changed & mask) {
+                    Bank::handleEvent(channel, updatePin(Bank::state[channel], 1, d1 & mask), 1, timestamp);
+                }
+                if (Bank::state[channel] & DEVICE_CONNECTED) {
+                    connected_channels |= mask;
+                } else {
+                    connected_channels &= ~mask;
+                }
+            } else {
+                Bank::state[channel] = (Bank::state[channel] & ~MASK_PINS) | ((sample >> (2*channel)) & MASK_PINS);
+                Bank::handleEvent(channel, (bit_received & mask) ? BitReceived : PinChanged, bool(d1_changed & mask), timestamp);
+            }
+        }
+    }
+
+    /**
+     * Updates the state of all channels from a port sample taken now.
+     */
+    inline void setPortState(uint8_t sample) {
+        setPortState(sample, Wiegand::now());
+    }
+};
@@ -0,0 +1,139 @@
+/*
+ * Fixed-capacity, lock-free ring buffer with a single producer and a single consumer.
+ *
+ * The producer is usually an interrupt handler and the consumer the main loop.
+ * Neither side ever blocks or disables interruptions: The producer only writes `head`
+ * and the consumer only writes `tail`, and both indices fit in a single byte, so
+ * they are updated atomically even on 8-bit AVRs.
+ *
+ * This assumes producer and consumer run on the same core (e.g., ISR + main loop).
+ */
+#pragma once
+
+#include <stdint.h>
+
+/**
+ * Compiler barrier: Keeps item accesses from being reordered around index updates
+ */
+#define WIEGAND_BARRIER() asm volatile("" ::: "memory")
+
+template<typename T, uint8_t CAPACITY>
+class WiegandRingBuffer {
+    static_assert(CAPACITY > 0 && CAPACITY <= 128 && (CAPACITY & (CAPACITY - 1)) == 0,
+                  "CAPACITY must be a power of 2, up to 128");
+
+private:
+    T items[CAPACITY];
+    volatile uint8_t head;
+    volatile uint8_t tail;
+
+public:
+    WiegandRingBuffer() : head(0), tail(0) {}
+
+    /**
+     * Number of items waiting to be consumed
+     */
+    inline uint8_t size() const {
+        return uint8_t(head - tail);
+    }
+
+    /**
+     * Number of items that can still be pushed
+     */
+    inline uint8_t available() const {
+        return CAPACITY - size();
+    }
+
+    inline bool empty() const {
+        return head == tail;
+    }
+
+    /**
+     * Adds an item to the buffer. Producer side only.
+     *
+     * Returns false if the buffer is full, in which case the item is dropped.
+     */
+    inline bool push(const T& item) {
+        uint8_t h = head;
+        if (uint8_t(h - tail) >= CAPACITY) {
+            return false;
+        }
+        items[h & (CAPACITY - 1)] = item;
+        WIEGAND_BARRIER();
+        head = h + 1;
+        return true;
+    }
+
+    /**
+     * Gets the next free slot, so that an item can be written in place. Producer side only.
+     *
+     * The item is only visible to the consumer after `publish()`.
+     * Returns nullptr if the buffer is full.
+     */
+    inline T* claim() {
+        uint8_t h = head;
+        if (uint8_t(h - tail) >= CAPACITY) {
+            return nullptr;
+        }
+        return &items[h & (CAPACITY - 1)];
+    }
+
+    /**
+     * Makes the item written on the slot returned by `claim()` visible to the consumer. Producer side only.
+     */
+    inline void publish() {
+        WIEGAND_BARRIER();
+        head = head + 1;
+    }
+
+    /**
+     * Gets the oldest item, without removing it. Consumer side only.
+     *
+     * Returns nullptr if the buffer is empty.
+     */
+    inline T* peek() {
+        uint8_t t = tail;
+        if (t == head) {
+            return nullptr;
+        }
+        WIEGAND_BARRIER();
+        return &items[t & (CAPACITY - 1)];
+    }
+
+    /**
+     * Removes the oldest item. Consumer side only.
+     *
+     * Returns false if the buffer is empty.
+     */
+    inline bool pop(T& item) {
+        T* oldest = peek();
+        if (!oldest) {
+            return false;
+        }
+        item = *oldest;
+        WIEGAND_BARRIER();
+        tail = tail + 1;
+        return true;
+    }
+
+    /**
+     * Removes the oldest item, without copying it. Consumer side only.
+     *
+     * Returns false if the buffer is empty.
+     */
+    inline bool discard() {
+        if (tail == head) {
+            return false;
+        }
+        WIEGAND_BARRIER();
+        tail = tail + 1;
+        return true;
+    }
+
+    /**
+     * Discards all pending items. Consumer side only.
+     */
+    inline void clear() {
+        tail = head;
+    }
+};
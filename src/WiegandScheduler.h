@@ -0,0 +1,226 @@
+/*
+ * Timeout scheduler shared by many `Wiegand` instances.
+ *
+ * Instead of calling `flush()` on every reader from the main loop, attach them all to a scheduler
+ * and call its `service()`: Readers with a message being received are kept in a min-heap ordered
+ * by deadline, so that `service()` only looks at those whose deadline has passed, and `nextDeadline()`
+ * tells how long the main loop may sleep.
+ *
+ * Deadlines only ever get pushed back while a message is being received, so a reader is queued once
+ * per message, and re-queued with its new deadline if it wasn't due yet when its turn came.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <Wiegand.h>
+
+/**
+ * Disables interruptions while in scope, and restores them as they were when leaving it.
+ *
+ * Only AVRs can tell if they were enabled (from `SREG`): Elsewhere, they are always enabled on the way out
+ */
+class WiegandInterruptLock {
+#ifdef SREG
+    uint8_t sreg;
+
+public:
+    inline WiegandInterruptLock() : sreg(SREG) {
+        noInterrupts();
+    }
+
+    inline ~WiegandInterruptLock() {
+        SREG = sreg;
+    }
+#else
+public:
+    inline WiegandInterruptLock() {
+        noInterrupts();
+    }
+
+    inline ~WiegandInterruptLock() {
+        interrupts();
+    }
+#endif
+};
+
+/**
+ * `CAPACITY` is the number of readers that can be attached, up to 254.
+ *
+ * All readers must measure time in the same unit (See `WiegandTiming::setTimeouts()`), which is the unit of the scheduler:
+ * Their timings must be attached before the readers are.
+ */
+template<uint8_t CAPACITY=8>
+class WiegandScheduler {
+    static_assert(CAPACITY > 0 && CAPACITY < 0xFF, "CAPACITY must be between 1 and 254");
+
+private:
+    struct Slot {
+        WiegandScheduler* scheduler;
+        Wiegand* wiegand;
+        unsigned long deadline;
+        uint8_t position;   // On the heap, `NOT_QUEUED` if it isn't there
+    };
+
+    static const uint8_t NOT_QUEUED = 0xFF;
+
+    Slot slots[CAPACITY];
+    uint8_t heap[CAPACITY];
+    uint8_t attached;
+    volatile uint8_t queued;
+
+    inline bool earlier(uint8_t a, uint8_t b) {
+        return long(slots[heap[a]].deadline - slots[heap[b]].deadline) < 0;
+    }
+
+    inline void swap(uint8_t a, uint8_t b) {
+        uint8_t slot = heap[a];
+        heap[a] = heap[b];
+        heap[b] = slot;
+        slots[heap[a]].position = a;
+        slots[heap[b]].position = b;
+    }
+
+    void siftUp(uint8_t position) {
+        while (position > 0 && earlier(position, (position - 1) / 2)) {
+            swap(position, (position - 1) / 2);
+            position = (position - 1) / 2;
+        }
+    }
+
+    void siftDown(uint8_t position) {
+        while (true) {
+            //Children past position 127 don't fit in a byte
+            uint8_t first = position;
+            uint16_t left = 2*uint16_t(position) + 1;
+            uint16_t right = left + 1;
+            if (left < queued && earlier(uint8_t(left), first)) {
+                first = uint8_t(left);
+            }
+            if (right < queued && earlier(uint8_t(right), first)) {
+                first = uint8_t(right);
+            }
+            if (first == position) {
+                return;
+            }
+            swap(position, first);
+            position = first;
+        }
+    }
+
+    /**
+     * Takes the reader with the earliest deadline out of the heap
+     */
+    Slot& pop() {
+        Slot& slot = slots[heap[0]];
+        queued = queued - 1;
+        if (queued) {
+            swap(0, queued);
+            siftDown(0);
+        }
+        slot.position = NOT_QUEUED;
+        return slot;
+    }
+
+    /**
+     * Called by a reader whose deadline may have changed.
+     *
+     * Since this happens on every bit, it only touches the heap for new messages, or for deadlines that came closer.
+     */
+    static void onDeadline(Wiegand* wiegand, Slot* slot) {
+        WiegandScheduler* self = slot->scheduler;
+        unsigned long deadline;
+        if (!wiegand->nextDeadline(deadline)) {
+            return;
+        }
+        if (slot->position == NOT_QUEUED) {
+            slot->deadline = deadline;
+            slot->position = self->queued;
+            self->heap[self->queued] = uint8_t(slot - self->slots);
+            self->queued = self->queued + 1;
+            self->siftUp(slot->position);
+        } else if (long(deadline - slot->deadline) < 0) {
+            slot->deadline = deadline;
+            self->siftUp(slot->position);
+        }
+    }
+
+public:
+    WiegandScheduler() : attached(0), queued(0) {}
+
+    /**
+     * Schedules the timeouts of `wiegand`. This replaces its deadline callback.
+     *
+     * Returns false if there are already `CAPACITY` readers attached,
+     * or if `wiegand` doesn't measure time in the same unit as those already attached
+     */
+    bool attach(Wiegand& wiegand) {
+        if (attached >= CAPACITY || (attached && wiegand.microseconds() != slots[0].wiegand->microseconds())) {
+            return false;
+        }
+        Slot& slot = slots[attached++];
+        slot.scheduler = this;
+        slot.wiegand = &wiegand;
+        slot.position = NOT_QUEUED;
+        wiegand.onDeadline(onDeadline, &slot);
+        return true;
+    }
+
+    /**
+     * Flushes the readers whose deadline is up to `now`, sending out their messages.
+     *
+     * `now` is in the unit of the readers: `Wiegand::nowMicros()` if their timings are in microseconds.
+     *
+     * Like `Wiegand::flush()`, this runs with interruptions disabled, and leaves them as they were.
+     * Readers that received more bits since they were queued are queued again, with their new deadline.
+     */
+    void service(unsigned long now) {
+        WiegandInterruptLock lock;
+        while (queued && long(now - slots[heap[0]].deadline) >= 0) {
+            Slot& slot = pop();
+            unsigned long deadline;
+            if (!slot.wiegand->nextDeadline(deadline)) {
+                //Message already sent out, e.g. when its expected size was reached
+                continue;
+            }
+            if (long(now - deadline) >= 0) {
+                slot.wiegand->flush(now);
+            } else {
+                onDeadline(slot.wiegand, &slot);
+            }
+        }
+    }
+
+    /**
+     * Same as above, at the current time, in the unit of the readers
+     */
+    inline void service() {
+        if (attached) {
+            service(slots[0].wiegand->time());
+        }
+    }
+
+    /**
+     * Tells the earliest deadline of all readers, i.e., when `service()` must be called next.
+     *
+     * It may be earlier than needed (if that reader received more bits since), never later.
+     * Returns false if no reader is receiving a message.
+     *
+     * Interruptions are left as they were, so that the main loop may keep them disabled
+     * from this check until it goes to sleep (See the `low_power` example).
+     */
+    bool nextDeadline(unsigned long& deadline) {
+        WiegandInterruptLock lock;
+        bool pending = queued > 0;
+        if (pending) {
+            deadline = slots[heap[0]].deadline;
+        }
+        return pending;
+    }
+
+    /**
+     * Number of readers waiting for a deadline
+     */
+    inline uint8_t pending() const {
+        return queued;
+    }
+};
@@ -0,0 +1,110 @@
+#include <WiegandTiming.h>
+#include <WiegandCore.h>
+
+using namespace WiegandCore;
+
+WiegandTiming::WiegandTiming() :
+    microseconds(false), timeout_multiple(0),
+    frame_gap(Wiegand::TIMEOUT), bit_gap(0), settle_time(Wiegand::TIMEOUT),
+    timeout_min(0), timeout_max(0), frame_timeout(Wiegand::TIMEOUT), bit_period(0), bit_timestamp(0),
+    pulse_min(0), pulse_max(0), interval_min(0), pulse_start(0),
+    rejected(0), message_rejected(false)
+{
+}
+
+/**
+ * Replaces `Wiegand::TIMEOUT`, in milliseconds, or in microseconds if `microseconds` is set.
+ */
+void WiegandTiming::setTimeouts(unsigned long frame_gap, unsigned long bit_gap, unsigned long settle_time, bool microseconds) {
+    this->frame_gap = frame_gap;
+    this->bit_gap = bit_gap;
+    this->settle_time = settle_time;
+    this->microseconds = microseconds;
+    frame_timeout = frame_gap;
+}
+
+/**
+ * Ends messages after a quiet time learned from the reader, instead of the fixed `frame_gap`.
+ */
+void WiegandTiming::setAdaptiveTimeout(uint8_t multiple, unsigned long min_timeout, unsigned long max_timeout) {
+    timeout_multiple = multiple;
+    timeout_min = min_timeout;
+    timeout_max = max_timeout;
+    bit_period = 0;
+}
+
+/**
+ * Lower limit of the adaptive timeout, `MIN_TIMEOUT` milliseconds by default
+ */
+unsigned long WiegandTiming::minTimeout() {
+    return timeout_min ? timeout_min : (microseconds ? MIN_TIMEOUT * 1000UL : MIN_TIMEOUT);
+}
+
+/**
+ * Upper limit of the adaptive timeout, `MAX_TIMEOUT` milliseconds by default
+ */
+unsigned long WiegandTiming::maxTimeout() {
+    return timeout_max ? timeout_max : (microseconds ? MAX_TIMEOUT * 1000UL : MAX_TIMEOUT);
+}
+
+/**
+ * Interval between bits learned from the reader, in milliseconds, rounded up. 0 if it wasn't measured yet
+ */
+unsigned long WiegandTiming::bitPeriod() {
+    return (bit_period + (1 << PERIOD_FRACTION) - 1) >> PERIOD_FRACTION;
+}
+
+/**
+ * Rejects pulses that can't be bits
+ */
+void WiegandTiming::setPulseLimits(unsigned long min_width, unsigned long max_width, unsigned long min_interval) {
+    pulse_min = min_width;
+    pulse_max = max_width;
+    interval_min = min_interval;
+}
+
+/**
+ * Tells if the pulse that ended at `timestamp` is within the limits set with `setPulseLimits()`
+ */
+bool WiegandTiming::pulseAccepted(uint8_t bits, unsigned long timestamp) {
+    unsigned long width = timestamp - pulse_start;
+    //Only bits of the same message are too close
+    if (width >= pulse_min && (!pulse_max || width <= pulse_max) && (bits == 0 || timestamp - bit_timestamp >= interval_min)) {
+        return true;
+    }
+    rejected++;
+    //While idle, there is no message to blame it on
+    if (bits > 0) {
+        message_rejected = true;
+    }
+    return false;
+}
+
+/**
+ * Takes a bit received at `timestamp`, and updates the timeout that ends the message
+ */
+bool WiegandTiming::bitReceived(uint8_t bits, unsigned long timestamp) {
+    bool stalled = false;
+    unsigned long interval = timestamp - bit_timestamp;
+    if (bits > 0) {
+        if (bit_gap && interval > bit_gap) {
+            stalled = true;
+        } else if (timeout_multiple) {
+            learnBitPeriod(bit_period, interval);
+        }
+    } else if (timeout_multiple && bit_period && interval <= maxTimeout()) {
+        //The gap ended the previous message, but it isn't longer than a bit may take:
+        //It is a reader that got slower, and it must be learned, or its messages would be cut after every bit
+        learnBitPeriod(bit_period, interval);
+    }
+    bit_timestamp = timestamp;
+    frame_timeout = timeout_multiple ? adaptiveTimeout(bit_period, timeout_multiple, minTimeout(), maxTimeout()) : frame_gap;
+    return !stalled;
+}
+
+/**
+ * Forgets what was learned from the reader
+ */
+void WiegandTiming::forget() {
+    bit_period = 0;
+}
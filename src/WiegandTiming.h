@@ -0,0 +1,134 @@
+/*
+ * Optional timing of a `Wiegand` instance.
+ *
+ * A plain `Wiegand` ends messages after the fixed `Wiegand::TIMEOUT` milliseconds. Timeouts of its own
+ * (in milliseconds or microseconds), a timeout learned from the reader and pulse limits are configured here instead,
+ * and attached with `Wiegand::setTiming()`, so that instances that don't use them don't take RAM for them:
+ *
+ *     WiegandTiming timing;
+ *     timing.setTimeouts(600, 300, 1000, true);
+ *     wiegand.setTiming(&timing);
+ *
+ * It also keeps what was learned from the reader, so each instance needs its own.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <Wiegand.h>
+
+class WiegandTiming {
+    friend class Wiegand;
+
+private:
+    bool microseconds;
+    uint8_t timeout_multiple;
+    unsigned long frame_gap;
+    unsigned long bit_gap;
+    unsigned long settle_time;
+    unsigned long timeout_min;
+    unsigned long timeout_max;
+    unsigned long frame_timeout;
+    unsigned long bit_period;
+    unsigned long bit_timestamp;
+    unsigned long pulse_min;
+    unsigned long pulse_max;
+    unsigned long interval_min;
+    unsigned long pulse_start;
+    unsigned long rejected;
+    bool message_rejected;
+
+    /**
+     * Tells if the pulse that ended at `timestamp` is within the limits set with `setPulseLimits()`.
+     *
+     * `bits` is the size of the message being received: Only bits of the same message can be too close.
+     * Pulses that aren't accepted are counted, see `rejectedPulses()`.
+     */
+    bool pulseAccepted(uint8_t bits, unsigned long timestamp);
+
+    /**
+     * Takes a bit received at `timestamp`, on a message that already has `bits` bits, and updates the timeout that ends it.
+     *
+     * Returns false if it came more than `bit_gap` after the previous one, i.e., the transmission stalled
+     */
+    bool bitReceived(uint8_t bits, unsigned long timestamp);
+
+    /**
+     * Limits of the adaptive timeout, with the defaults converted to the unit of the timeouts
+     */
+    unsigned long minTimeout();
+    unsigned long maxTimeout();
+
+    /**
+     * Forgets what was learned from the reader, e.g. because it was disconnected
+     */
+    void forget();
+
+public:
+    /**
+     * Default limits of `setAdaptiveTimeout()`, in milliseconds
+     */
+    static const uint8_t MIN_TIMEOUT = 4;
+    static const uint8_t MAX_TIMEOUT = Wiegand::TIMEOUT;
+
+    WiegandTiming();
+
+    /**
+     * Replaces `Wiegand::TIMEOUT`, in milliseconds, or in microseconds if `microseconds` is set.
+     *
+     * - `frame_gap` is the quiet time after the last bit that ends a message.
+     * - `bit_gap` is the longest interval between two bits of a message. A bit coming later
+     *   means the transmission stalled, and the message is reported as a `Communication` error. 0 means no limit.
+     * - `settle_time` is the quiet time a reader must keep after being connected (or after a transmission error)
+     *   before bits are accepted.
+     *
+     * With `microseconds`, time is read from the microseconds time source (`micros()`, see `Wiegand::setMicrosSource()`)
+     * instead of the time source, and so are the timestamps
+     * taken by `Wiegand::setPinState()` and `Wiegand::lastEventTime()`. It must be set before `Wiegand::begin()`.
+     */
+    void setTimeouts(unsigned long frame_gap, unsigned long bit_gap, unsigned long settle_time, bool microseconds=false);
+
+    /**
+     * Ends messages after a quiet time learned from the reader, instead of the fixed `frame_gap`.
+     *
+     * The interval between bits of each message is measured, and messages end after `multiple` times
+     * the longest recent interval, but never sooner than `min_timeout` or later than `max_timeout`
+     * (in milliseconds, or microseconds, see `setTimeouts()`).
+     * Left as 0, they are `MIN_TIMEOUT` and `MAX_TIMEOUT` milliseconds, whatever the unit of the timeouts.
+     * E.g., a reader sending a bit every 2ms with `multiple=4` has its messages sent out 8ms after the last bit.
+     *
+     * Gaps that end a message, but aren't longer than `max_timeout`, are learned as well, so that a reader that gets slower
+     * only has its first message cut.
+     * Until the first interval is measured, and after the reader is disconnected, messages end after `max_timeout`.
+     * `multiple=0` goes back to the fixed `frame_gap`.
+     */
+    void setAdaptiveTimeout(uint8_t multiple, unsigned long min_timeout=0, unsigned long max_timeout=0);
+
+    /**
+     * Interval between bits learned from the reader, in milliseconds (or microseconds), rounded up. 0 if it wasn't measured yet
+     */
+    unsigned long bitPeriod();
+
+    /**
+     * Rejects pulses that can't be bits, e.g. spikes picked up by long cables.
+     *
+     * A bit is sent as a pulse, usually 20 to 100us long, on one of the data lines.
+     * Pulses shorter than `min_width` or longer than `max_width`, and bits coming less than `min_interval`
+     * after the previous one, are not added to the message, and the message being received goes on.
+     *
+     * Rejected pulses aren't reported one by one, since a noisy line may produce lots of them: They are counted
+     * (See `rejectedPulses()`), and a message that fails its checks after pulses were rejected while receiving it
+     * is reported once as a `PulseRejected` error, with its data, instead of its own error.
+     * A message that is still valid is sent out as usual, and pulses rejected before the first bit of a message are only counted.
+     *
+     * Limits are in the same unit as the timeouts, so they are meant for microseconds (See `setTimeouts()`).
+     * 0 means no limit, which is the default for all of them.
+     */
+    void setPulseLimits(unsigned long min_width, unsigned long max_width=0, unsigned long min_interval=0);
+
+    /**
+     * Number of pulses rejected since this timing was created, see `setPulseLimits()`
+     */
+    inline unsigned long rejectedPulses() {
+        return rejected;
+    }
+};